@@ -1,6 +1,7 @@
 #include "bigint64.hpp"
 
 #include "bigint64_add.cpp"
+#include "bigint64_alloc.cpp"
 #include "bigint64_basic.cpp"
 #include "bigint64_bit.cpp"
 #include "bigint64_compare.cpp"
@@ -8,24 +9,72 @@
 #include "bigint64_io.cpp"
 #include "bigint64_mul.cpp"
 #include "bigint64_ext.cpp"
+#include "bigint64_file.cpp"
+#include "bigint64_pool.cpp"
+#include "bigint64_expr.cpp"
 namespace calc {
 BigInt<uint128_t> operator&(BigInt<uint128_t> lhs,
                             const BigInt<uint128_t>& rhs) {
-    return lhs &= rhs;
+    lhs &= rhs;
+    return lhs;
+}
+BigInt<uint128_t> operator&(const BigInt<uint128_t>& lhs,
+                            BigInt<uint128_t>&& rhs) {
+    rhs &= lhs;
+    return std::move(rhs);
+}
+BigInt<uint128_t> operator&(BigInt<uint128_t>&& lhs, BigInt<uint128_t>&& rhs) {
+    // the longer one is likely to have the room for the result
+    if (rhs.Length() > lhs.Length()) {
+        rhs &= lhs;
+        return std::move(rhs);
+    }
+    lhs &= rhs;
+    return std::move(lhs);
 }
 BigInt<uint128_t> operator|(BigInt<uint128_t> lhs,
                             const BigInt<uint128_t>& rhs) {
-    return lhs |= rhs;
+    lhs |= rhs;
+    return lhs;
+}
+BigInt<uint128_t> operator|(const BigInt<uint128_t>& lhs,
+                            BigInt<uint128_t>&& rhs) {
+    rhs |= lhs;
+    return std::move(rhs);
+}
+BigInt<uint128_t> operator|(BigInt<uint128_t>&& lhs, BigInt<uint128_t>&& rhs) {
+    if (rhs.Length() > lhs.Length()) {
+        rhs |= lhs;
+        return std::move(rhs);
+    }
+    lhs |= rhs;
+    return std::move(lhs);
 }
 BigInt<uint128_t> operator^(BigInt<uint128_t> lhs,
                             const BigInt<uint128_t>& rhs) {
-    return lhs ^= rhs;
+    lhs ^= rhs;
+    return lhs;
+}
+BigInt<uint128_t> operator^(const BigInt<uint128_t>& lhs,
+                            BigInt<uint128_t>&& rhs) {
+    rhs ^= lhs;
+    return std::move(rhs);
+}
+BigInt<uint128_t> operator^(BigInt<uint128_t>&& lhs, BigInt<uint128_t>&& rhs) {
+    if (rhs.Length() > lhs.Length()) {
+        rhs ^= lhs;
+        return std::move(rhs);
+    }
+    lhs ^= rhs;
+    return std::move(lhs);
 }
 BigInt<uint128_t> operator<<(BigInt<uint128_t> lhs, uint64_t rhs) {
-    return lhs <<= rhs;
+    lhs <<= rhs;
+    return lhs;
 }
 BigInt<uint128_t> operator>>(BigInt<uint128_t> lhs, uint64_t rhs) {
-    return lhs >>= rhs;
+    lhs >>= rhs;
+    return lhs;
 }
 #ifndef __cpp_impl_three_way_comparison
 bool operator<(const BigInt<uint128_t>& lhs, const BigInt<uint128_t>& rhs) {
@@ -48,53 +97,109 @@ bool operator!=(const BigInt<uint128_t>& lhs, const BigInt<uint128_t>& rhs) {
 }
 #endif
 BigInt<uint128_t> operator+(BigInt<uint128_t> lhs, uint64_t rhs) {
-    return lhs += rhs;
+    lhs += rhs;
+    return lhs;
 }
 BigInt<uint128_t> operator+(BigInt<uint128_t> lhs,
                             const BigInt<uint128_t>& rhs) {
-    return lhs += rhs;
+    lhs += rhs;
+    return lhs;
+}
+BigInt<uint128_t> operator+(const BigInt<uint128_t>& lhs,
+                            BigInt<uint128_t>&& rhs) {
+    rhs += lhs;
+    return std::move(rhs);
+}
+BigInt<uint128_t> operator+(BigInt<uint128_t>&& lhs, BigInt<uint128_t>&& rhs) {
+    if (rhs.Length() > lhs.Length()) {
+        rhs += lhs;
+        return std::move(rhs);
+    }
+    lhs += rhs;
+    return std::move(lhs);
 }
 BigInt<uint128_t> operator-(BigInt<uint128_t> lhs, uint64_t rhs) {
-    return lhs -= rhs;
+    lhs -= rhs;
+    return lhs;
 }
 BigInt<uint128_t> operator-(BigInt<uint128_t> lhs,
                             const BigInt<uint128_t>& rhs) {
-    return lhs -= rhs;
+    lhs -= rhs;
+    return lhs;
+}
+BigInt<uint128_t> operator-(const BigInt<uint128_t>& lhs,
+                            BigInt<uint128_t>&& rhs) {
+    // lhs - rhs = -rhs + lhs
+    rhs.ToOpposite();
+    rhs += lhs;
+    return std::move(rhs);
+}
+BigInt<uint128_t> operator-(BigInt<uint128_t>&& lhs, BigInt<uint128_t>&& rhs) {
+    if (rhs.Length() > lhs.Length()) {
+        rhs.ToOpposite();
+        rhs += lhs;
+        return std::move(rhs);
+    }
+    lhs -= rhs;
+    return std::move(lhs);
 }
 BigInt<uint128_t> BigInt<uint128_t>::MNTMul(BigInt lhs, const BigInt& rhs) {
-    return lhs.MNTMulEq(rhs);
+    lhs.MNTMulEq(rhs);
+    return lhs;
 }
 BigInt<uint128_t> BigInt<uint128_t>::RMNTMul(BigInt lhs, const BigInt& rhs) {
-    return lhs.RMNTMulEq(rhs);
+    lhs.RMNTMulEq(rhs);
+    return lhs;
 }
 BigInt<uint128_t> BigInt<uint128_t>::PlainMul(BigInt lhs, const BigInt& rhs) {
-    return lhs.PlainMulEq(rhs);
+    lhs.PlainMulEq(rhs);
+    return lhs;
 }
 BigInt<uint128_t> BigInt<uint128_t>::MulKaratsuba(BigInt lhs,
                                                   const BigInt& rhs) {
-    return lhs.MulEqKaratsuba(rhs);
+    lhs.MulEqKaratsuba(rhs);
+    return lhs;
 }
 BigInt<uint128_t> operator*(BigInt<uint128_t> lhs, uint64_t rhs) {
-    return lhs *= rhs;
+    lhs *= rhs;
+    return lhs;
 }
 BigInt<uint128_t> BigInt<uint128_t>::DivD(BigInt lhs, const BigInt& rhs,
                                           BigInt* mod) {
-    return lhs.DivEqD(rhs, mod);
+    lhs.DivEqD(rhs, mod);
+    return lhs;
 }
 BigInt<uint128_t> BigInt<uint128_t>::Div(BigInt lhs, const BigInt& rhs,
                                          BigInt* mod) {
-    return lhs.DivEq(rhs, mod);
+    lhs.DivEq(rhs, mod);
+    return lhs;
 }
 BigInt<uint128_t> operator*(BigInt<uint128_t> lhs,
                             const BigInt<uint128_t>& rhs) {
-    return lhs *= rhs;
+    lhs *= rhs;
+    return lhs;
+}
+BigInt<uint128_t> operator*(const BigInt<uint128_t>& lhs,
+                            BigInt<uint128_t>&& rhs) {
+    rhs *= lhs;
+    return std::move(rhs);
+}
+BigInt<uint128_t> operator*(BigInt<uint128_t>&& lhs, BigInt<uint128_t>&& rhs) {
+    if (rhs.Length() > lhs.Length()) {
+        rhs *= lhs;
+        return std::move(rhs);
+    }
+    lhs *= rhs;
+    return std::move(lhs);
 }
 BigInt<uint128_t> operator/(BigInt<uint128_t> lhs, int64_t rhs) {
-    return lhs.DivEq64(rhs, nullptr);
+    lhs.DivEq64(rhs, nullptr);
+    return lhs;
 }
 BigInt<uint128_t> operator/(BigInt<uint128_t> lhs,
                             const BigInt<uint128_t>& rhs) {
-    return lhs.DivEq(rhs, nullptr);
+    lhs.DivEq(rhs, nullptr);
+    return lhs;
 }
 int64_t operator%(BigInt<uint128_t> lhs, int64_t rhs) {
     int64_t rv;
@@ -103,16 +208,68 @@ int64_t operator%(BigInt<uint128_t> lhs, int64_t rhs) {
 }
 BigInt<uint128_t> operator%(BigInt<uint128_t> lhs,
                             const BigInt<uint128_t>& rhs) {
-    return lhs %= rhs;
+    lhs %= rhs;
+    return lhs;
 }
 BigInt<uint128_t> BigInt<uint128_t>::Square(BigInt lhs) {
-    return lhs.SquareEq();
+    lhs.SquareEq();
+    return lhs;
 }
 BigInt<uint128_t> BigInt<uint128_t>::RMNTMulUB(BigInt lhs, const BigInt& rhs) {
-    return lhs.RMNTMulEqUB(rhs);
+    lhs.RMNTMulEqUB(rhs);
+    return lhs;
 }
 BigInt<uint128_t> BigInt<uint128_t>::DivR(BigInt lhs, const BigInt& rhs,
                                           BigInt* mod) {
-    return lhs.DivEqR(rhs, mod);
+    lhs.DivEqR(rhs, mod);
+    return lhs;
+}
+BigInt<uint128_t> BigInt<uint128_t>::DivExact(BigInt lhs, const BigInt& rhs) {
+    lhs.DivExactEq(rhs);
+    return lhs;
+}
+BigInt<uint128_t>& Add(BigInt<uint128_t>& dest, const BigInt<uint128_t>& a,
+                       const BigInt<uint128_t>& b) {
+    if (&a == &b) {
+        if (&dest != &a) dest = a;
+        return dest <<= 1;
+    }
+    if (&dest == &b) return dest += a;
+    if (&dest != &a) dest = a;
+    return dest += b;
+}
+BigInt<uint128_t>& Sub(BigInt<uint128_t>& dest, const BigInt<uint128_t>& a,
+                       const BigInt<uint128_t>& b) {
+    if (&a == &b) {
+        dest.SetLen(0, false);
+        return dest;
+    }
+    if (&dest == &b) {
+        dest.ToOpposite();
+        return dest += a;
+    }
+    if (&dest != &a) dest = a;
+    return dest -= b;
+}
+BigInt<uint128_t>& Mul(BigInt<uint128_t>& dest, const BigInt<uint128_t>& a,
+                       const BigInt<uint128_t>& b) {
+    if (&a == &b) {
+        if (&dest != &a) dest = a;
+        return dest.SquareEq();
+    }
+    if (&dest == &b) return dest *= a;
+    if (&dest != &a) dest = a;
+    return dest *= b;
+}
+BigInt<uint128_t>& DivMod(BigInt<uint128_t>& quot, BigInt<uint128_t>* rem,
+                          const BigInt<uint128_t>& a,
+                          const BigInt<uint128_t>& b) {
+    if (&quot == &b || rem == &b) {
+        // the divisor is read to the end
+        BigInt<uint128_t> divisor(b);
+        return DivMod(quot, rem, a, divisor);
+    }
+    if (&quot != &a) quot = a;
+    return quot.DivEq(b, rem);
 }
 }  // namespace calc
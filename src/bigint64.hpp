@@ -1,15 +1,33 @@
 #pragma once
+#include <atomic>
+#include <charconv>
 #include <complex>
+#include <condition_variable>
 #include <cstdint>
 #include <cstring>
+#include <deque>
+#include <exception>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
 #include <random>
+#include <thread>
+#include <type_traits>
 #include <utility>
+#include <vector>
 namespace calc {
 // complex (mod Mersenne Prime)
 class CompMp;
 template <typename IntT>
 class BigInt;
+class SpecialModulus;
+struct BigIntTerm;
+struct ExprEval;
+// true for the nodes of lazy expressions, see Lazy
+template <typename E>
+struct IsBigIntExpr : std::false_type {};
 
 using uint128_t = __uint128_t;
 using int128_t = __int128_t;
@@ -24,10 +42,31 @@ class BigInt<uint128_t> {
     uint128_t* val_;
     uint64_t len_;  // actual used length
     uint64_t cap_;  // capacity
+    // *end_ is zero, the limbs past it are unspecified
     uint128_t* end_;
+    // where val_ came from, unless it is small_
+    std::pmr::memory_resource* res_;
     static constexpr uint64_t LIMB = 128;
     static constexpr uint64_t LOGLIMB = 7;
     static constexpr uint64_t MAX_CAP = uint64_t(1) << 63;
+    // values up to SMALL_CAP - 1 limbs live inline, no allocation
+    static constexpr uint64_t SMALL_CAP = 4;
+    // alignment of the limbs not inline, a cache line
+    static constexpr uint64_t LIMB_ALIGN = 64;
+    uint128_t small_[SMALL_CAP];
+    // thresholds in uint64 digits
+    static constexpr uint64_t MUL_KARA_LIMIT = 32;
+    static constexpr uint64_t MUL_FFT_LIMIT = 2048;
+    static constexpr uint64_t DIV_BZ_LIMIT = 64;
+    // divide and conquer radix conversion above these, the quadratic loops
+    // below
+    static constexpr uint64_t CONV_READ_DC_LIMIT = 4096;
+    static constexpr uint64_t CONV_WRITE_DC_LIMIT = 160;
+    // ToChars converts on the stack up to this
+    static constexpr uint64_t TO_CHARS_STACK_LIMIT = 64;
+    static constexpr uint64_t CONV_PARALLEL_LIMIT = 4096;
+    // chars, the text buffer of streamed input and output
+    static constexpr uint64_t STREAM_BLOCK = uint64_t(1) << 20;
 
     // random device
     // inline static std::random_device rand_dev_;
@@ -37,13 +76,120 @@ class BigInt<uint128_t> {
     inline static auto rand_ = std::uniform_int_distribution<uint64_t>();
     // inline static std::uniform_int_distribution<uint64_t> rand_;
 
+    // bigint64_alloc.cpp
+    // scratch of the algorithms, from the scratch stack of this thread;
+    // free it in reverse order of allocation
+    template <typename T>
+    static T* NewScratch(uint64_t n);
+    template <typename T>
+    static void DeleteScratch(const T* scratch, uint64_t n);
+
     // bigint64_div.cpp
-    uint64_t DivDCore(const BigInt& rhs, uint64_t v1, uint64_t v2, uint64_t u1h,
-                      uint64_t u1l, uint64_t u2, uint64_t bias, bool half_more);
-    void DivRNormal(const BigInt& rhs, BigInt* mod = nullptr);
+    static uint64_t SubMul64(uint64_t* dest, const uint64_t* src, uint64_t n,
+                             uint64_t q);
+    static uint64_t AddN64(uint64_t* dest, const uint64_t* src, uint64_t n);
+    static uint64_t InvMod64(uint64_t x);
+    static uint64_t DivDCore(uint64_t* u, const uint64_t* v, uint64_t n,
+                             uint64_t v1, uint64_t v2, uint64_t u1h,
+                             uint64_t u1l, uint64_t u2);
+    // a < b, both without leading zero digits
+    static bool Less64(const uint64_t* a, uint64_t an, const uint64_t* b,
+                       uint64_t bn);
+    static uint64_t SubN64(uint64_t* dest, const uint64_t* src, uint64_t n);
+    static uint64_t SubProd64(uint64_t* u, uint64_t un, const uint64_t* a,
+                              uint64_t an, const uint64_t* b, uint64_t bn);
+    static void DivSchool64(uint64_t* q, uint64_t* u, uint64_t qn,
+                            const uint64_t* v, uint64_t n);
+    static uint64_t DivBZ64(uint64_t* q, uint64_t* u, const uint64_t* v,
+                            uint64_t n);
+    // {q, w} = {u, w} / {v, n} mod 2^(64w) for odd v, u[0..w) is cleared
+    static void DivHensel64(uint64_t* q, uint64_t* u, const uint64_t* v,
+                            uint64_t n, uint64_t w);
 
     // bigint64_mul.cpp
-    BigInt& RMNTMulEqGiven(const int64_t* src, uint64_t n, uint64_t rlen);
+    static uint64_t AddMul64(uint64_t* dest, const uint64_t* src, uint64_t n,
+                             uint64_t q);
+    static uint64_t MulAdd64(uint64_t* dest, uint64_t n, uint64_t q,
+                             uint64_t c);
+    static void MulBase64(uint64_t* dest, const uint64_t* a, uint64_t an,
+                          const uint64_t* b, uint64_t bn);
+    static void MulKara64(uint64_t* dest, const uint64_t* a, uint64_t an,
+                          const uint64_t* b, uint64_t bn, uint64_t* tmp);
+    // the 16-bit digits of |x| into dest, zero-padded to n
+    template <typename T>
+    static void LoadDigits16(T* dest, uint64_t n, const BigInt& x);
+    template <typename T>
+    static void LoadDigits16(T* dest, uint64_t n, const uint64_t* a,
+                             uint64_t an);
+    // the low dn digits of {a, an} times the number transformed into src
+    // by RMNT of n, which must hold the whole product; v is scratch of n
+    static void MulGiven64(uint64_t* dest, uint64_t dn, const uint64_t* a,
+                           uint64_t an, const int64_t* src, uint64_t n,
+                           int64_t* v);
+    // dest[0..an+bn) = {a, an} * {b, bn} by RMNT
+    static void MulFFT64(uint64_t* dest, const uint64_t* a, uint64_t an,
+                         const uint64_t* b, uint64_t bn);
+
+    // bigint64_basic.cpp
+    // set to the non-negative value of n uint64 digits, or its negation
+    void AssignDigits(const uint64_t* src, uint64_t n, bool neg = false);
+    // |x| in x.len_ limbs: the storage of x, or its negation in scratch
+    // that the caller frees with DeleteScratch(p, x.len_) if x.Sign()
+    static const uint128_t* Magnitude(const BigInt& x);
+    // len_ of new_len, at least 2, with the limbs left to the caller; the
+    // value is dropped, so nothing is copied or filled when storage grows
+    void SetLenUninit(uint64_t new_len);
+    // small_ for up to SMALL_CAP limbs, otherwise from res
+    uint128_t* NewLimbs(uint64_t cap, std::pmr::memory_resource* res);
+    // limbs of NewLimbs(cap, res_)
+    void DeleteLimbs(uint128_t* limbs, uint64_t cap);
+    // exchange values, the inline limbs are copied
+    void Swap(BigInt& rhs) noexcept;
+
+    // bigint64_io.cpp
+    // most digits of base in an int64, and base to that power
+    static uint64_t ChunkDigits(int base, int64_t* power);
+    // base^(chunk*2^i) for the divide and conquer conversions up to n digits
+    static std::vector<BigInt> ConvPowers(int base, uint64_t n);
+    // digits of {digits, m} backward from last, down to first at most; the
+    // words are consumed, returns where the digits start
+    static char* WriteChunks(uint64_t* digits, uint64_t m, char* first,
+                             char* last, int base, const char* charset);
+    // exactly n digits of non-negative x < base^n, zero padded
+    static void WriteDigits(BigInt& x, char* dest, uint64_t n, int base,
+                            const char* charset,
+                            const std::vector<BigInt>& pow);
+    // digits [first, first + n) of x in base 2^bits
+    static void WriteDigitsPow2(const BigInt& x, char* dest, uint64_t first,
+                                uint64_t n, uint64_t bits,
+                                const char* charset);
+    // as WriteDigits, but sent to sink from the top in blocks through buf
+    static void StreamDigits(
+        BigInt& x, uint64_t n, int base, const char* charset,
+        const std::vector<BigInt>& pow, char* buf,
+        const std::function<void(const char*, size_t)>& sink);
+    // value of n valid digits, reusing the buffer of result
+    static void ReadDigits(BigInt& result, const char* src, uint64_t n,
+                           int base, const std::vector<BigInt>& pow);
+    static void ReadDigitsPow2(BigInt& result, const char* src, uint64_t n,
+                               uint64_t bits);
+    void AssignText(const char* src, uint64_t n, int base);
+    // lo * 2^e <= base^k <= hi * 2^e, with hi cut to about p bits
+    static void PowerBounds(int base, uint64_t k, uint64_t p, BigInt* lo,
+                            BigInt* hi, uint64_t* e);
+
+    // bigint64_file.cpp
+    // borrowed limbs followed by a zero limb, never freed or grown
+    BigInt(uint128_t* val, uint64_t len);
+    friend class BigIntView;
+    friend class SharedBigInt;
+    friend BigInt LoadBinary(const char* path, bool* ok);
+
+    // bigint64_expr.cpp
+    // sum of a or a*b over the terms, each negated if neg; products with a
+    // short operand are accumulated row by row in this storage
+    void AssignSum(const BigIntTerm* terms, uint64_t n);
+    friend struct ExprEval;
 
    public:
     // bigint64_basic.cpp
@@ -54,6 +200,13 @@ class BigInt<uint128_t> {
     virtual ~BigInt();
     BigInt& operator=(const BigInt& rhs);
     BigInt& operator=(BigInt&& rhs) noexcept;
+    // evaluate a lazy expression, see Lazy
+    template <typename E,
+              typename = std::enable_if_t<IsBigIntExpr<E>::value>>
+    BigInt(const E& expr);
+    template <typename E,
+              typename = std::enable_if_t<IsBigIntExpr<E>::value>>
+    BigInt& operator=(const E& expr);
     BigInt& GenRandom(uint64_t length, uint8_t fixed = 0);
     inline BigInt& RandomBits(uint64_t bitlen);
     explicit operator int64_t() const;
@@ -68,6 +221,8 @@ class BigInt<uint128_t> {
     void Shrink();
     double log2() const;
     double log10() const;
+    // exact number of digits of the absolute value, 1 for zero
+    uint64_t DigitCount(int base = 10) const;
     uint64_t TrailingZero() const;
     uint64_t BitLen() const;
     // input from big-endian data
@@ -85,6 +240,7 @@ class BigInt<uint128_t> {
     BigInt& operator^=(const BigInt& rhs);
     BigInt& operator<<=(uint64_t rhs);
     BigInt& operator>>=(uint64_t rhs);
+    BigInt& CutBit(uint64_t bitlen);
 
     // bigint64_add.cpp
     BigInt& operator+=(uint64_t rhs);
@@ -106,12 +262,29 @@ class BigInt<uint128_t> {
     // bigint64_io.cpp
     void Print(int base = 10, int showbase = 1, bool uppercase = false,
                std::FILE* f = stdout) const;
+    // streamed to sink in blocks of at most STREAM_BLOCK chars
+    void Print(const std::function<void(const char*, size_t)>& sink,
+               int base = 10, int showbase = 1, bool uppercase = false) const;
     friend std::ostream& operator<<(std::ostream& out,
                                     const BigInt<uint128_t>& rhs);
+    friend std::istream& operator>>(std::istream& in, BigInt<uint128_t>& rhs);
     std::string ToString(int base = 10, int showbase = 1,
                          bool uppercase = false) const;
     explicit BigInt(const char* str, size_t base = 0);
     explicit BigInt(const std::string& str, size_t base = 0);
+    // sign and digits without prefix, no allocation for small values;
+    // ec is value_too_large if [first, last) is too short
+    std::to_chars_result ToChars(char* first, char* last, int base = 10) const;
+    // upper bound of the chars ToChars writes
+    uint64_t ToCharsSize(int base = 10) const;
+    // optional '-' and digits, returns the chars consumed, 0 for no digits
+    // (and *this unchanged)
+    size_t FromChars(const char* first, const char* last, int base = 10);
+    // the first or the last n digits of the absolute value (all of them if
+    // there are fewer), about the cost of one multiplication of n digits
+    // instead of a whole conversion
+    std::string LeadingDigits(uint64_t n, int base = 10) const;
+    std::string TrailingDigits(uint64_t n, int base = 10) const;
 
     // bigint64_compare.cpp
 #ifdef __cpp_impl_three_way_comparison
@@ -132,6 +305,10 @@ class BigInt<uint128_t> {
     BigInt& DivEq(const BigInt& rhs, BigInt* mod = nullptr);
     // recursive
     BigInt& DivEqR(const BigInt& rhs, BigInt* mod = nullptr);
+    // exact division, *this must be divisible by rhs != 0 (checked if
+    // !NDEBUG, a zero rhs leaves *this unchanged otherwise)
+    BigInt& DivExactEq(const BigInt& rhs);
+    BigInt& DivExactEq(uint64_t rhs);
 
     // bigint64_mul.cpp
     BigInt& operator*=(uint64_t rhs);
@@ -152,6 +329,10 @@ class BigInt<uint128_t> {
     BigInt& ToNextPrime();
     friend BigInt PowMod(const BigInt& a, uint64_t p, const BigInt& n);
     friend BigInt PowMod(const BigInt& a, const BigInt& p, const BigInt& n);
+    friend BigInt PowMod(const BigInt& a, const BigInt& p,
+                         const SpecialModulus& n);
+    friend class SpecialModulus;
+    friend BigInt ExtGcdBin(BigInt a, BigInt b, BigInt* x, BigInt* y);
 
     // bigint64.cpp
     static BigInt RMNTMul(BigInt lhs, const BigInt& rhs);
@@ -163,10 +344,19 @@ class BigInt<uint128_t> {
     static BigInt Square(BigInt lhs);
     static BigInt RMNTMulUB(BigInt lhs, const BigInt& rhs);
     static BigInt DivR(BigInt lhs, const BigInt& rhs, BigInt* mod = nullptr);
+    static BigInt DivExact(BigInt lhs, const BigInt& rhs);
 };
 // bigint64_io.cpp
 std::ostream& operator<<(std::ostream& out, const BigInt<uint128_t>& rhs);
 std::istream& operator>>(std::istream& in, BigInt<uint128_t>& rhs);
+// fields of text separated by delim or line breaks, empty ones skipped, in
+// parallel; false (and out empty) if a field is not a number
+bool ParseBatch(const char* first, const char* last,
+                std::vector<BigInt<uint128_t>>* out, char delim = ',',
+                int base = 10);
+// each value followed by delim, formatted in parallel
+std::string FormatBatch(const BigInt<uint128_t>* values, size_t n,
+                        char delim = '\n', int base = 10);
 
 // bigint64_ext.cpp
 BigInt<uint128_t> BigProduct(uint64_t a, uint64_t b);
@@ -179,31 +369,85 @@ BigInt<uint128_t> PowMod(const BigInt<uint128_t>& a, const BigInt<uint128_t>& p,
 BigInt<uint128_t> GcdBin(BigInt<uint128_t> a, BigInt<uint128_t> b);
 BigInt<uint128_t> ExtGcdBin(BigInt<uint128_t> a, BigInt<uint128_t> b,
                             BigInt<uint128_t>* x, BigInt<uint128_t>* y);
+BigInt<uint128_t> PowMod(const BigInt<uint128_t>& a, const BigInt<uint128_t>& p,
+                         const SpecialModulus& n);
+BigInt<uint128_t> MulMod(const BigInt<uint128_t>& a, const BigInt<uint128_t>& b,
+                         const BigInt<uint128_t>& n);
+// for many products modulo one n, the form detected once
+BigInt<uint128_t> MulMod(const BigInt<uint128_t>& a, const BigInt<uint128_t>& b,
+                         const SpecialModulus& n);
+// floor of the root, 0 for negative a (or even k)
+BigInt<uint128_t> Sqrt(const BigInt<uint128_t>& a);
+BigInt<uint128_t> SqrtRem(const BigInt<uint128_t>& a, BigInt<uint128_t>* rem);
+BigInt<uint128_t> Root(const BigInt<uint128_t>& a, uint64_t k);
+
+// bigint64_file.cpp
+// one number in a text file, through mmap; base 0 detects the prefix
+BigInt<uint128_t> LoadText(const char* path, int base = 0,
+                           bool* ok = nullptr);
+// digits without prefix and a newline, false on I/O error
+bool SaveText(const char* path, const BigInt<uint128_t>& value,
+              int base = 10);
+// native binary format: a 64-byte header with version, sign, length and
+// checksum, then the little-endian uint128 limbs and a zero limb
+bool SaveBinary(const char* path, const BigInt<uint128_t>& value);
+BigInt<uint128_t> LoadBinary(const char* path, bool* ok = nullptr);
 
 // bigint64.cpp
 BigInt<uint128_t> operator&(BigInt<uint128_t> lhs,
                             const BigInt<uint128_t>& rhs);
+// an expiring operand lends its buffer to the result
+BigInt<uint128_t> operator&(const BigInt<uint128_t>& lhs,
+                            BigInt<uint128_t>&& rhs);
+BigInt<uint128_t> operator&(BigInt<uint128_t>&& lhs, BigInt<uint128_t>&& rhs);
 BigInt<uint128_t> operator|(BigInt<uint128_t> lhs,
                             const BigInt<uint128_t>& rhs);
+BigInt<uint128_t> operator|(const BigInt<uint128_t>& lhs,
+                            BigInt<uint128_t>&& rhs);
+BigInt<uint128_t> operator|(BigInt<uint128_t>&& lhs, BigInt<uint128_t>&& rhs);
 BigInt<uint128_t> operator^(BigInt<uint128_t> lhs,
                             const BigInt<uint128_t>& rhs);
+BigInt<uint128_t> operator^(const BigInt<uint128_t>& lhs,
+                            BigInt<uint128_t>&& rhs);
+BigInt<uint128_t> operator^(BigInt<uint128_t>&& lhs, BigInt<uint128_t>&& rhs);
 BigInt<uint128_t> operator<<(BigInt<uint128_t> lhs, uint64_t rhs);
 BigInt<uint128_t> operator>>(BigInt<uint128_t> lhs, uint64_t rhs);
 BigInt<uint128_t> operator+(BigInt<uint128_t> lhs, uint64_t rhs);
 BigInt<uint128_t> operator+(BigInt<uint128_t> lhs,
                             const BigInt<uint128_t>& rhs);
+BigInt<uint128_t> operator+(const BigInt<uint128_t>& lhs,
+                            BigInt<uint128_t>&& rhs);
+BigInt<uint128_t> operator+(BigInt<uint128_t>&& lhs, BigInt<uint128_t>&& rhs);
 BigInt<uint128_t> operator-(BigInt<uint128_t> lhs, uint64_t rhs);
 BigInt<uint128_t> operator-(BigInt<uint128_t> lhs,
                             const BigInt<uint128_t>& rhs);
+BigInt<uint128_t> operator-(const BigInt<uint128_t>& lhs,
+                            BigInt<uint128_t>&& rhs);
+BigInt<uint128_t> operator-(BigInt<uint128_t>&& lhs, BigInt<uint128_t>&& rhs);
 BigInt<uint128_t> operator*(BigInt<uint128_t> lhs, uint64_t rhs);
 BigInt<uint128_t> operator*(BigInt<uint128_t> lhs,
                             const BigInt<uint128_t>& rhs);
+BigInt<uint128_t> operator*(const BigInt<uint128_t>& lhs,
+                            BigInt<uint128_t>&& rhs);
+BigInt<uint128_t> operator*(BigInt<uint128_t>&& lhs, BigInt<uint128_t>&& rhs);
 BigInt<uint128_t> operator/(BigInt<uint128_t> lhs, int64_t rhs);
 BigInt<uint128_t> operator/(BigInt<uint128_t> lhs,
                             const BigInt<uint128_t>& rhs);
 int64_t operator%(BigInt<uint128_t> lhs, int64_t rhs);
 BigInt<uint128_t> operator%(BigInt<uint128_t> lhs,
                             const BigInt<uint128_t>& rhs);
+// dest = a op b in the storage of dest, which may be a or b; a copy of b is
+// taken only if DivMod has to write to it. quot and rem must differ, rem
+// may be nullptr.
+BigInt<uint128_t>& Add(BigInt<uint128_t>& dest, const BigInt<uint128_t>& a,
+                       const BigInt<uint128_t>& b);
+BigInt<uint128_t>& Sub(BigInt<uint128_t>& dest, const BigInt<uint128_t>& a,
+                       const BigInt<uint128_t>& b);
+BigInt<uint128_t>& Mul(BigInt<uint128_t>& dest, const BigInt<uint128_t>& a,
+                       const BigInt<uint128_t>& b);
+BigInt<uint128_t>& DivMod(BigInt<uint128_t>& quot, BigInt<uint128_t>* rem,
+                          const BigInt<uint128_t>& a,
+                          const BigInt<uint128_t>& b);
 #ifndef __cpp_impl_three_way_comparison
 bool operator<(const BigInt<uint128_t>& lhs, const BigInt<uint128_t>& rhs);
 bool operator>(const BigInt<uint128_t>& lhs, const BigInt<uint128_t>& rhs);
@@ -212,6 +456,416 @@ bool operator>=(const BigInt<uint128_t>& lhs, const BigInt<uint128_t>& rhs);
 bool operator==(const BigInt<uint128_t>& lhs, const BigInt<uint128_t>& rhs);
 bool operator!=(const BigInt<uint128_t>& lhs, const BigInt<uint128_t>& rhs);
 #endif
+
+// bigint64_file.cpp
+// a read-only BigInt over limbs owned elsewhere, which must be followed by a
+// zero limb and outlive the view; zero by default
+class BigIntView {
+    union {
+        BigInt<uint128_t> value_;
+    };
+    // a high part of less than two limbs, with its sign and the zero limb
+    uint128_t short_[3];
+    void Point(const uint128_t* val, uint64_t len);
+
+   public:
+    BigIntView();
+    BigIntView(const uint128_t* val, uint64_t len);
+    BigIntView(const BigIntView& rhs);
+    BigIntView& operator=(const BigIntView& rhs);
+    // value_ is not destroyed, it owns nothing
+    ~BigIntView() {}
+    // x >> (128 * pos) over the limbs of x from pos up, such as its high
+    // half; x must keep its storage while the view is used
+    static BigIntView High(const BigInt<uint128_t>& x, uint64_t pos);
+    const BigInt<uint128_t>& Value() const { return value_; }
+    operator const BigInt<uint128_t>&() const { return value_; }
+};
+// a SaveBinary file as a read-only operand, the limbs stay in the mapping;
+// zero if the file cannot be mapped or fails the checks
+class MappedBigInt {
+    void* map_;
+    size_t size_;
+    BigIntView view_;
+
+   public:
+    // verify = false skips the checksum, so pages are faulted in on use
+    explicit MappedBigInt(const char* path, bool verify = true);
+    MappedBigInt(const MappedBigInt&) = delete;
+    MappedBigInt& operator=(const MappedBigInt&) = delete;
+    ~MappedBigInt();
+    explicit operator bool() const { return map_; }
+    const BigInt<uint128_t>& Value() const { return view_; }
+    operator const BigInt<uint128_t>&() const { return view_; }
+};
+// values as one buffer: a header, the limb offsets, then the limbs of each
+// value and a zero limb, 16-byte aligned; meant for one process to hand
+// many values to another
+std::vector<uint8_t> SerializeBatch(const BigInt<uint128_t>* values,
+                                    size_t n);
+// views into data, which must be 16-byte aligned (as a vector or a mapping
+// is) and outlive them; empty and *ok false if data is malformed
+std::vector<BigIntView> DeserializeBatch(const uint8_t* data, size_t size,
+                                         bool* ok = nullptr);
+
+// bigint64_alloc.cpp
+// new and delete, 64-byte aligned; while huge pages are on, blocks of
+// 2 MiB or more are mapped on a 2 MiB boundary and advised for them
+std::pmr::memory_resource* DefaultLimbResource();
+// huge pages for the large blocks allocated from now on, on by default;
+// returns the previous setting
+bool SetHugePages(bool on);
+// resource of the limbs this thread allocates, DefaultLimbResource() by
+// default
+std::pmr::memory_resource* LimbResource();
+// nullptr for the default, returns the previous setting
+std::pmr::memory_resource* SetLimbResource(std::pmr::memory_resource* res);
+// the limb resource of this thread for the lifetime of the scope
+class LimbResourceScope {
+    std::pmr::memory_resource* prev_;
+
+   public:
+    explicit LimbResourceScope(std::pmr::memory_resource* res)
+        : prev_(SetLimbResource(res)) {}
+    LimbResourceScope(const LimbResourceScope&) = delete;
+    LimbResourceScope& operator=(const LimbResourceScope&) = delete;
+    ~LimbResourceScope() { SetLimbResource(prev_); }
+};
+// free lists of power-of-two blocks for one thread. Blocks may be freed by
+// other threads, they are handed back through a lock-free list; values
+// allocated from it must not outlive the pool.
+class LimbPool : public std::pmr::memory_resource {
+    struct Node {
+        Node* next;
+        uint64_t size_class;
+    };
+    static constexpr uint64_t CLASSES = 64;
+    // blocks kept per size class
+    static constexpr uint64_t MAX_CACHED = 64;
+    // bytes, larger blocks go to upstream directly
+    static constexpr uint64_t MAX_BLOCK = uint64_t(1) << 24;
+    static constexpr uint64_t ALIGN = 64;
+    std::pmr::memory_resource* upstream_;
+    std::thread::id owner_;
+    Node* free_[CLASSES] = {};
+    uint64_t count_[CLASSES] = {};
+    std::atomic<Node*> remote_{nullptr};
+    void Push(uint64_t size_class, void* block);
+    void* do_allocate(size_t bytes, size_t align) override;
+    void do_deallocate(void* p, size_t bytes, size_t align) override;
+    bool do_is_equal(
+        const std::pmr::memory_resource& other) const noexcept override;
+
+   public:
+    explicit LimbPool(
+        std::pmr::memory_resource* upstream = DefaultLimbResource());
+    LimbPool(const LimbPool&) = delete;
+    LimbPool& operator=(const LimbPool&) = delete;
+    ~LimbPool() override;
+    // the pool of this thread
+    static LimbPool& Local();
+    // return the cached blocks to upstream
+    void Release();
+};
+// an immutable value whose copies share one buffer, for constants, moduli
+// and cached powers passed around or kept in containers. The limbs are
+// moved to the default resource, so handles may outlive any limb resource and
+// be dropped on any thread.
+class SharedBigInt {
+    std::shared_ptr<BigInt<uint128_t>> value_;
+    // value with its limbs in the default resource, or inline
+    static BigInt<uint128_t> Rehome(BigInt<uint128_t> value);
+
+   public:
+    // zero, shared by all default handles
+    SharedBigInt();
+    SharedBigInt(BigInt<uint128_t> value);
+    const BigInt<uint128_t>& Value() const { return *value_; }
+    operator const BigInt<uint128_t>&() const { return *value_; }
+    // handles sharing the buffer, this one included
+    long UseCount() const { return value_.use_count(); }
+    // a value to modify, moved out if no other handle shares it and copied
+    // otherwise; this becomes zero
+    BigInt<uint128_t> Take();
+};
+
+// bigint64_pool.cpp
+// fork-join worker pool shared by the parallel algorithms
+class WorkerPool {
+    struct Task {
+        std::function<void()> fn{};
+        // thrown by fn, rethrown by Fork
+        std::exception_ptr error{};
+        std::atomic<bool> done{false};
+        // out of line, the cleanup path of Fork would trip -Winline
+        ~Task();
+    };
+    std::mutex mutex_{};
+    // queued tasks for the workers
+    std::condition_variable cv_{};
+    // finished tasks for the waiting callers
+    std::condition_variable done_cv_{};
+    std::deque<Task*> queue_{};
+    std::vector<std::thread> threads_{};
+    bool stop_ = false;
+    inline static std::atomic<WorkerPool*> shared_{nullptr};
+    void Run(Task* task);
+    bool RunOne();
+    void Worker();
+    void Wait(const Task& task);
+
+   public:
+    explicit WorkerPool(unsigned threads);
+    ~WorkerPool();
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+    // hardware_concurrency() threads in total unless SetShared
+    static WorkerPool& Shared();
+    // nullptr for the default pool, pool must outlive its use
+    static void SetShared(WorkerPool* pool);
+    // including the calling thread
+    unsigned Threads() const;
+    // run a and b, possibly in parallel; the waiting thread runs queued
+    // tasks meanwhile, so nested forks are fine. b runs under the default
+    // limb resource. An exception of a or b is rethrown once b is done or
+    // dequeued, that of a first.
+    void Fork(const std::function<void()>& a, const std::function<void()>& b);
+    // fn(begin, end) on blocks of [0, n) no smaller than grain
+    void ParallelFor(uint64_t n, uint64_t grain,
+                     const std::function<void(uint64_t, uint64_t)>& fn);
+};
+
+// modulus n = 2^k - c with small c (c < 0 for 2^k + |c|), e.g. Mersenne
+// and Fermat numbers, reduced by folding the bits above k back with a
+// small multiply instead of division
+class SpecialModulus {
+    BigInt<uint128_t> n_;
+    uint64_t k_;
+    int64_t c_;
+
+   public:
+    // bigint64_ext.cpp
+    SpecialModulus(uint64_t k, int64_t c);
+    // detect the form, Special() is false if n is not of it
+    explicit SpecialModulus(const BigInt<uint128_t>& n);
+    // whether n is of the form, and its k and c if so; reads the digits
+    // of n in place and stops at the first one that does not fit
+    static bool Detect(const BigInt<uint128_t>& n, uint64_t* k = nullptr,
+                       int64_t* c = nullptr);
+    bool Special() const { return k_; }
+    const BigInt<uint128_t>& Value() const { return n_; }
+    // to [0, n)
+    BigInt<uint128_t>& Reduce(BigInt<uint128_t>& x) const;
+    BigInt<uint128_t> MulMod(BigInt<uint128_t> a,
+                             const BigInt<uint128_t>& b) const;
+};
+
+// bigint64_expr.cpp
+struct BigIntTerm {
+    const BigInt<uint128_t>* a;
+    // nullptr unless the term is a*b
+    const BigInt<uint128_t>* b;
+    bool neg;
+};
+// an operand of a lazy expression
+struct LazyBigInt {
+    const BigInt<uint128_t>& value;
+};
+// lhs op rhs, op one of + - * & | ^
+template <char Op, typename L, typename R>
+struct BigIntExpr {
+    L lhs;
+    R rhs;
+};
+// lhs << n or lhs >> n
+template <char Op, typename L>
+struct BigIntShift {
+    L lhs;
+    uint64_t n;
+};
+template <>
+struct IsBigIntExpr<LazyBigInt> : std::true_type {};
+template <char Op, typename L, typename R>
+struct IsBigIntExpr<BigIntExpr<Op, L, R>> : std::true_type {};
+template <char Op, typename L>
+struct IsBigIntExpr<BigIntShift<Op, L>> : std::true_type {};
+// Lazy(a) * b + Lazy(c) * d - e builds a tree of the operators on it, which
+// is evaluated when assigned to a BigInt: in the storage of that BigInt,
+// sums of any length in one carry pass, short products accumulated into
+// the sum. Operands are referenced, so assign in the same statement.
+inline LazyBigInt Lazy(const BigInt<uint128_t>& x) { return {x}; }
+inline LazyBigInt AsLazy(const BigInt<uint128_t>& x) { return {x}; }
+template <typename E>
+const E& AsLazy(const E& e) {
+    return e;
+}
+template <typename T>
+using LazyNode = std::conditional_t<std::is_same<T, BigInt<uint128_t>>::value,
+                                    LazyBigInt, T>;
+// one side lazy, the other lazy or a BigInt
+template <typename L, typename R>
+inline constexpr bool LAZY_OPERANDS =
+    (IsBigIntExpr<L>::value || IsBigIntExpr<R>::value) &&
+    (IsBigIntExpr<L>::value || std::is_same<L, BigInt<uint128_t>>::value) &&
+    (IsBigIntExpr<R>::value || std::is_same<R, BigInt<uint128_t>>::value);
+template <typename L, typename R,
+          typename = std::enable_if_t<LAZY_OPERANDS<L, R>>>
+BigIntExpr<'+', LazyNode<L>, LazyNode<R>> operator+(const L& lhs,
+                                                    const R& rhs) {
+    return {AsLazy(lhs), AsLazy(rhs)};
+}
+template <typename L, typename R,
+          typename = std::enable_if_t<LAZY_OPERANDS<L, R>>>
+BigIntExpr<'-', LazyNode<L>, LazyNode<R>> operator-(const L& lhs,
+                                                    const R& rhs) {
+    return {AsLazy(lhs), AsLazy(rhs)};
+}
+template <typename L, typename R,
+          typename = std::enable_if_t<LAZY_OPERANDS<L, R>>>
+BigIntExpr<'*', LazyNode<L>, LazyNode<R>> operator*(const L& lhs,
+                                                    const R& rhs) {
+    return {AsLazy(lhs), AsLazy(rhs)};
+}
+template <typename L, typename R,
+          typename = std::enable_if_t<LAZY_OPERANDS<L, R>>>
+BigIntExpr<'&', LazyNode<L>, LazyNode<R>> operator&(const L& lhs,
+                                                    const R& rhs) {
+    return {AsLazy(lhs), AsLazy(rhs)};
+}
+template <typename L, typename R,
+          typename = std::enable_if_t<LAZY_OPERANDS<L, R>>>
+BigIntExpr<'|', LazyNode<L>, LazyNode<R>> operator|(const L& lhs,
+                                                    const R& rhs) {
+    return {AsLazy(lhs), AsLazy(rhs)};
+}
+template <typename L, typename R,
+          typename = std::enable_if_t<LAZY_OPERANDS<L, R>>>
+BigIntExpr<'^', LazyNode<L>, LazyNode<R>> operator^(const L& lhs,
+                                                    const R& rhs) {
+    return {AsLazy(lhs), AsLazy(rhs)};
+}
+template <typename L, typename = std::enable_if_t<IsBigIntExpr<L>::value>>
+BigIntShift<'<', L> operator<<(const L& lhs, uint64_t n) {
+    return {lhs, n};
+}
+template <typename L, typename = std::enable_if_t<IsBigIntExpr<L>::value>>
+BigIntShift<'>', L> operator>>(const L& lhs, uint64_t n) {
+    return {lhs, n};
+}
+// terms of a sum
+template <typename E>
+struct BigIntTermCount : std::integral_constant<uint64_t, 1> {};
+template <typename L, typename R>
+struct BigIntTermCount<BigIntExpr<'+', L, R>>
+    : std::integral_constant<uint64_t, BigIntTermCount<L>::value +
+                                           BigIntTermCount<R>::value> {};
+template <typename L, typename R>
+struct BigIntTermCount<BigIntExpr<'-', L, R>>
+    : std::integral_constant<uint64_t, BigIntTermCount<L>::value +
+                                           BigIntTermCount<R>::value> {};
+struct ExprEval {
+    // whether x is an operand of e
+    static bool Uses(const LazyBigInt& e, const BigInt<uint128_t>* x) {
+        return &e.value == x;
+    }
+    template <char Op, typename L, typename R>
+    static bool Uses(const BigIntExpr<Op, L, R>& e,
+                     const BigInt<uint128_t>* x) {
+        return Uses(e.lhs, x) || Uses(e.rhs, x);
+    }
+    template <char Op, typename L>
+    static bool Uses(const BigIntShift<Op, L>& e, const BigInt<uint128_t>* x) {
+        return Uses(e.lhs, x);
+    }
+    // an operand as it is, or else evaluated into the next of tmp
+    static const BigInt<uint128_t>* Operand(const LazyBigInt& e,
+                                            BigInt<uint128_t>*&) {
+        return &e.value;
+    }
+    template <typename E>
+    static const BigInt<uint128_t>* Operand(const E& e,
+                                            BigInt<uint128_t>*& tmp) {
+        Assign(*tmp, e);
+        return tmp++;
+    }
+    template <typename E>
+    static void Collect(const E& e, bool neg, BigIntTerm*& term,
+                        BigInt<uint128_t>*& tmp) {
+        *term++ = {Operand(e, tmp), nullptr, neg};
+    }
+    template <typename L, typename R>
+    static void Collect(const BigIntExpr<'+', L, R>& e, bool neg,
+                        BigIntTerm*& term, BigInt<uint128_t>*& tmp) {
+        Collect(e.lhs, neg, term, tmp);
+        Collect(e.rhs, neg, term, tmp);
+    }
+    template <typename L, typename R>
+    static void Collect(const BigIntExpr<'-', L, R>& e, bool neg,
+                        BigIntTerm*& term, BigInt<uint128_t>*& tmp) {
+        Collect(e.lhs, neg, term, tmp);
+        Collect(e.rhs, !neg, term, tmp);
+    }
+    template <typename L, typename R>
+    static void Collect(const BigIntExpr<'*', L, R>& e, bool neg,
+                        BigIntTerm*& term, BigInt<uint128_t>*& tmp) {
+        auto a = Operand(e.lhs, tmp);
+        *term++ = {a, Operand(e.rhs, tmp), neg};
+    }
+    static void Assign(BigInt<uint128_t>& dest, const LazyBigInt& e) {
+        if (&dest != &e.value) dest = e.value;
+    }
+    template <char Op, typename L, typename R>
+    static void Assign(BigInt<uint128_t>& dest,
+                       const BigIntExpr<Op, L, R>& e) {
+        if constexpr (Op == '+' || Op == '-' || Op == '*') {
+            constexpr uint64_t n = BigIntTermCount<BigIntExpr<Op, L, R>>::value;
+            BigIntTerm terms[n];
+            // each term has at most two evaluated operands
+            BigInt<uint128_t> tmp[n << 1];
+            auto term = terms;
+            auto next = tmp;
+            Collect(e, false, term, next);
+            dest.AssignSum(terms, term - terms);
+        } else if (Uses(e.rhs, &dest)) {
+            BigInt<uint128_t> result;
+            Assign(result, e.lhs);
+            Apply<Op>(result, e.rhs);
+            dest = std::move(result);
+        } else {
+            Assign(dest, e.lhs);
+            Apply<Op>(dest, e.rhs);
+        }
+    }
+    template <char Op, typename L>
+    static void Assign(BigInt<uint128_t>& dest, const BigIntShift<Op, L>& e) {
+        Assign(dest, e.lhs);
+        if constexpr (Op == '<')
+            dest <<= e.n;
+        else
+            dest >>= e.n;
+    }
+    template <char Op, typename E>
+    static void Apply(BigInt<uint128_t>& dest, const E& e) {
+        BigInt<uint128_t> tmp;
+        auto next = &tmp;
+        auto& rhs = *Operand(e, next);
+        if constexpr (Op == '&')
+            dest &= rhs;
+        else if constexpr (Op == '|')
+            dest |= rhs;
+        else
+            dest ^= rhs;
+    }
+};
+template <typename E, typename>
+BigInt<uint128_t>::BigInt(const E& expr) : BigInt(0) {
+    ExprEval::Assign(*this, expr);
+}
+template <typename E, typename>
+BigInt<uint128_t>& BigInt<uint128_t>::operator=(const E& expr) {
+    ExprEval::Assign(*this, expr);
+    return *this;
+}
 inline BigInt<uint128_t>& BigInt<uint128_t>::RandomBits(uint64_t bitlen) {
     auto q = (bitlen + 127) >> 7, r = bitlen & 127;
     return GenRandom(q, r ? r : 128);
@@ -0,0 +1,319 @@
+#include <sys/mman.h>
+
+#include "bigint64.hpp"
+namespace calc {
+static std::atomic<bool> huge_pages{true};
+bool SetHugePages(bool on) {
+    return huge_pages.exchange(on, std::memory_order_relaxed);
+}
+// new and delete, except that blocks of a huge page or more get a mapping
+// of their own on a huge page boundary, advised for huge pages. A header
+// in the cache line before the block records where it came from, so the
+// switch may change while blocks are alive.
+class DefaultResource : public std::pmr::memory_resource {
+    struct Large {
+        // nullptr if the block is from new and delete
+        char* map;
+        uint64_t size;
+    };
+    static constexpr uint64_t HUGE_PAGE = uint64_t(1) << 21;
+    static constexpr uint64_t HEAD = 64;
+    void* do_allocate(size_t bytes, size_t align) override {
+        auto heap = std::pmr::new_delete_resource();
+        if (bytes < HUGE_PAGE || align > HEAD)
+            return heap->allocate(bytes, align);
+        char* p;
+        if (huge_pages.load(std::memory_order_relaxed)) {
+            // over-mapped by a huge page for the alignment; the pages
+            // never touched cost nothing
+            uint64_t body = (bytes + HUGE_PAGE - 1) & ~(HUGE_PAGE - 1);
+            uint64_t size = body + HUGE_PAGE;
+            auto map = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (map == MAP_FAILED) throw std::bad_alloc();
+            p = reinterpret_cast<char*>(
+                (reinterpret_cast<uintptr_t>(map) + HEAD + HUGE_PAGE - 1) &
+                ~uintptr_t(HUGE_PAGE - 1));
+            madvise(p, body, MADV_HUGEPAGE);
+            *reinterpret_cast<Large*>(p - HEAD) = {static_cast<char*>(map),
+                                                   size};
+        } else {
+            p = static_cast<char*>(heap->allocate(bytes + HEAD, HEAD)) + HEAD;
+            *reinterpret_cast<Large*>(p - HEAD) = {nullptr, bytes + HEAD};
+        }
+        return p;
+    }
+    void do_deallocate(void* p, size_t bytes, size_t align) override {
+        auto heap = std::pmr::new_delete_resource();
+        if (bytes < HUGE_PAGE || align > HEAD) {
+            heap->deallocate(p, bytes, align);
+            return;
+        }
+        auto head = reinterpret_cast<Large*>(static_cast<char*>(p) - HEAD);
+        if (head->map)
+            munmap(head->map, head->size);
+        else
+            heap->deallocate(head, head->size, HEAD);
+    }
+    bool do_is_equal(
+        const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+};
+std::pmr::memory_resource* DefaultLimbResource() {
+    // never destroyed, as values with static storage may outlive it
+    static auto res = new DefaultResource();
+    return res;
+}
+static thread_local std::pmr::memory_resource* limb_resource = nullptr;
+std::pmr::memory_resource* LimbResource() {
+    return limb_resource ? limb_resource : DefaultLimbResource();
+}
+std::pmr::memory_resource* SetLimbResource(std::pmr::memory_resource* res) {
+    std::swap(res, limb_resource);
+    return res;
+}
+// bump-pointer stack for the scratch of one thread, like TMP_ALLOC of GMP.
+// Chunks come from the limb resource; everything goes back to it once the
+// last block is freed outside of any ScratchScope, except one spare chunk
+// of the default resource that is kept for the next operation.
+class ScratchArena {
+    struct Chunk {
+        Chunk* prev;
+        std::pmr::memory_resource* res;
+        uint64_t size;
+        // top of prev when this chunk was pushed
+        char* saved;
+    };
+    static constexpr uint64_t ALIGN = 64;
+    static constexpr uint64_t HEAD = (sizeof(Chunk) + ALIGN - 1) & ~(ALIGN - 1);
+    static constexpr uint64_t MIN_CHUNK = uint64_t(1) << 16;
+    static constexpr uint64_t MAX_SPARE = uint64_t(1) << 22;
+    Chunk* chunk_ = nullptr;
+    Chunk* spare_ = nullptr;
+    char* top_ = nullptr;
+    // blocks not freed yet
+    uint64_t live_ = 0;
+    // open ScratchScopes
+    uint64_t depth_ = 0;
+    static uint64_t Round(uint64_t bytes) {
+        return bytes ? (bytes + ALIGN - 1) & ~(ALIGN - 1) : ALIGN;
+    }
+    static char* Base(Chunk* chunk) {
+        return reinterpret_cast<char*>(chunk) + HEAD;
+    }
+    static char* End(Chunk* chunk) {
+        return reinterpret_cast<char*>(chunk) + chunk->size;
+    }
+    void Push(uint64_t bytes) {
+        if (!chunk_ && spare_ && spare_->size >= HEAD + bytes &&
+            LimbResource() == spare_->res) {
+            chunk_ = spare_;
+            spare_ = nullptr;
+            chunk_->saved = top_;
+            top_ = Base(chunk_);
+            return;
+        }
+        uint64_t size = std::max(HEAD + bytes, MIN_CHUNK);
+        if (chunk_) size = std::max(size, chunk_->size << 1);
+        size = Round(size);
+        auto res = LimbResource();
+        auto chunk = static_cast<Chunk*>(res->allocate(size, ALIGN));
+        *chunk = {chunk_, res, size, top_};
+        chunk_ = chunk;
+        top_ = Base(chunk);
+    }
+    void Pop() {
+        auto chunk = chunk_;
+        chunk_ = chunk->prev;
+        top_ = chunk->saved;
+        // only the default resource surely outlives the spare
+        if (!chunk_ && !spare_ && chunk->size <= MAX_SPARE &&
+            chunk->res == DefaultLimbResource()) {
+            spare_ = chunk;
+            return;
+        }
+        chunk->res->deallocate(chunk, chunk->size, ALIGN);
+    }
+
+   public:
+    struct Mark {
+        Chunk* chunk;
+        char* top;
+        uint64_t live;
+    };
+    ScratchArena() = default;
+    ScratchArena(const ScratchArena&) = delete;
+    ScratchArena& operator=(const ScratchArena&) = delete;
+    ~ScratchArena() {
+        Release({nullptr, nullptr, 0});
+        if (spare_) spare_->res->deallocate(spare_, spare_->size, ALIGN);
+    }
+    static ScratchArena& Local() {
+        static thread_local ScratchArena arena;
+        return arena;
+    }
+    void* Allocate(uint64_t bytes) {
+        bytes = Round(bytes);
+        if (!chunk_ || uint64_t(End(chunk_) - top_) < bytes) Push(bytes);
+        auto p = top_;
+        top_ += bytes;
+        ++live_;
+        return p;
+    }
+    void Deallocate(const void* p, uint64_t bytes) {
+        // blocks below the top wait for the release
+        bytes = Round(bytes);
+        if (static_cast<const char*>(p) + bytes == top_) top_ -= bytes;
+        if (!--live_ && !depth_) Release({nullptr, nullptr, 0});
+    }
+    // the next bytes of allocations need no new chunk
+    void Reserve(uint64_t bytes) {
+        bytes = Round(bytes);
+        if (!chunk_ || uint64_t(End(chunk_) - top_) < bytes) Push(bytes);
+    }
+    Mark GetMark() const { return {chunk_, top_, live_}; }
+    void Release(const Mark& mark) {
+        while (chunk_ != mark.chunk) Pop();
+        top_ = mark.top;
+        live_ = mark.live;
+    }
+    friend class ScratchScope;
+};
+// scratch of one top-level operation, reserved up front from the operand
+// lengths and released at once when the scope ends
+class ScratchScope {
+    ScratchArena& arena_;
+    ScratchArena::Mark mark_;
+
+   public:
+    explicit ScratchScope(uint64_t bytes)
+        : arena_(ScratchArena::Local()), mark_(arena_.GetMark()) {
+        ++arena_.depth_;
+        arena_.Reserve(bytes);
+    }
+    ScratchScope(const ScratchScope&) = delete;
+    ScratchScope& operator=(const ScratchScope&) = delete;
+    ~ScratchScope() {
+        --arena_.depth_;
+        arena_.Release(mark_);
+    }
+};
+// bytes of scratch RMNTMulEq and SquareEq take for a product of limbs limbs
+static uint64_t MulScratch(uint64_t limbs) {
+    uint64_t n = 1;
+    while (n < limbs) n <<= 1;
+    // two transforms of 8 int64 per limb, rounded up to the chunk alignment
+    return (n << 4) * sizeof(int64_t) + 128;
+}
+template <typename T>
+T* BigInt<uint128_t>::NewScratch(uint64_t n) {
+    static_assert(std::is_trivially_destructible<T>::value,
+                  "scratch is never destroyed");
+    static_assert(alignof(T) <= 64, "scratch is aligned to 64 bytes");
+    return static_cast<T*>(ScratchArena::Local().Allocate(n * sizeof(T)));
+}
+template <typename T>
+void BigInt<uint128_t>::DeleteScratch(const T* scratch, uint64_t n) {
+    ScratchArena::Local().Deallocate(scratch, n * sizeof(T));
+}
+LimbPool::LimbPool(std::pmr::memory_resource* upstream)
+    : upstream_(upstream), owner_(std::this_thread::get_id()) {}
+LimbPool::~LimbPool() { Release(); }
+LimbPool& LimbPool::Local() {
+    static thread_local LimbPool pool;
+    return pool;
+}
+void LimbPool::Push(uint64_t size_class, void* block) {
+    if (count_[size_class] == MAX_CACHED) {
+        upstream_->deallocate(block, uint64_t(1) << size_class, ALIGN);
+        return;
+    }
+    auto node = static_cast<Node*>(block);
+    node->next = free_[size_class];
+    free_[size_class] = node;
+    ++count_[size_class];
+}
+void LimbPool::Release() {
+    auto node = remote_.exchange(nullptr, std::memory_order_acquire);
+    while (node) {
+        auto next = node->next;
+        upstream_->deallocate(node, uint64_t(1) << node->size_class, ALIGN);
+        node = next;
+    }
+    for (uint64_t i = 0; i < CLASSES; ++i) {
+        while (free_[i]) {
+            node = free_[i];
+            free_[i] = node->next;
+            upstream_->deallocate(node, uint64_t(1) << i, ALIGN);
+        }
+        count_[i] = 0;
+    }
+}
+void* LimbPool::do_allocate(size_t bytes, size_t align) {
+    if (bytes > MAX_BLOCK || align > ALIGN)
+        return upstream_->allocate(bytes, align);
+    // blocks freed by other threads since the last call
+    if (remote_.load(std::memory_order_relaxed)) {
+        auto node = remote_.exchange(nullptr, std::memory_order_acquire);
+        while (node) {
+            auto next = node->next;
+            Push(node->size_class, node);
+            node = next;
+        }
+    }
+    uint64_t size_class = 4;
+    while ((uint64_t(1) << size_class) < bytes) ++size_class;
+    if (auto node = free_[size_class]) {
+        free_[size_class] = node->next;
+        --count_[size_class];
+        return node;
+    }
+    return upstream_->allocate(uint64_t(1) << size_class, ALIGN);
+}
+void LimbPool::do_deallocate(void* p, size_t bytes, size_t align) {
+    if (bytes > MAX_BLOCK || align > ALIGN) {
+        upstream_->deallocate(p, bytes, align);
+        return;
+    }
+    uint64_t size_class = 4;
+    while ((uint64_t(1) << size_class) < bytes) ++size_class;
+    if (std::this_thread::get_id() == owner_) {
+        Push(size_class, p);
+        return;
+    }
+    auto node = static_cast<Node*>(p);
+    node->size_class = size_class;
+    node->next = remote_.load(std::memory_order_relaxed);
+    while (!remote_.compare_exchange_weak(node->next, node,
+                                          std::memory_order_release,
+                                          std::memory_order_relaxed))
+        ;
+}
+bool LimbPool::do_is_equal(
+    const std::pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
+static std::shared_ptr<BigInt<uint128_t>> SharedZero() {
+    static const auto zero = std::make_shared<BigInt<uint128_t>>(0);
+    return zero;
+}
+SharedBigInt::SharedBigInt() : value_(SharedZero()) {}
+SharedBigInt::SharedBigInt(BigInt<uint128_t> value)
+    : value_(std::make_shared<BigInt<uint128_t>>(Rehome(std::move(value)))) {}
+BigInt<uint128_t> SharedBigInt::Rehome(BigInt<uint128_t> value) {
+    auto heap = DefaultLimbResource();
+    if (value.val_ != value.small_ && value.res_ != heap) {
+        LimbResourceScope scope(heap);
+        value = BigInt<uint128_t>(value);
+    }
+    return value;
+}
+BigInt<uint128_t> SharedBigInt::Take() {
+    BigInt<uint128_t> result = value_.use_count() == 1
+                                   ? std::move(*value_)
+                                   : BigInt<uint128_t>(*value_);
+    *this = SharedBigInt();
+    return result;
+}
+}  // namespace calc
@@ -1,9 +1,34 @@
 
 #include "bigint64.hpp"
 namespace calc {
+uint128_t* BigInt<uint128_t>::NewLimbs(uint64_t cap,
+                                       std::pmr::memory_resource* res) {
+    if (cap <= SMALL_CAP) return small_;
+    return static_cast<uint128_t*>(
+        res->allocate(cap * sizeof(uint128_t), LIMB_ALIGN));
+}
+void BigInt<uint128_t>::DeleteLimbs(uint128_t* limbs, uint64_t cap) {
+    if (limbs != small_)
+        res_->deallocate(limbs, cap * sizeof(uint128_t), LIMB_ALIGN);
+}
+void BigInt<uint128_t>::Swap(BigInt& rhs) noexcept {
+    bool inline_lhs = val_ == small_, inline_rhs = rhs.val_ == rhs.small_;
+    std::swap(small_, rhs.small_);
+    std::swap(val_, rhs.val_);
+    std::swap(len_, rhs.len_);
+    std::swap(cap_, rhs.cap_);
+    std::swap(res_, rhs.res_);
+    if (inline_rhs) val_ = small_;
+    if (inline_lhs) rhs.val_ = rhs.small_;
+    end_ = val_ + len_;
+    rhs.end_ = rhs.val_ + rhs.len_;
+}
 BigInt<uint128_t>::BigInt(int value)
-    : val_(new uint128_t[4]), len_(2), cap_(4), end_(val_ + 2) {
-    // std::memset(val_, 0, cap_ * sizeof(uint128_t));
+    : val_(small_),
+      len_(2),
+      cap_(SMALL_CAP),
+      end_(val_ + 2),
+      res_(LimbResource()) {
     std::fill(val_, val_ + cap_, 0);
     if (value < 0) {
         *val_ = -1;
@@ -15,24 +40,29 @@ BigInt<uint128_t>::BigInt(int value)
     }
 }
 BigInt<uint128_t>::BigInt(uint64_t value)
-    : val_(new uint128_t[4]), len_(2), cap_(4), end_(val_ + 2) {
-    // std::memset(val_, 0, cap_ * sizeof(uint128_t));
+    : val_(small_),
+      len_(2),
+      cap_(SMALL_CAP),
+      end_(val_ + 2),
+      res_(LimbResource()) {
     std::fill(val_, val_ + cap_, 0);
     *val_ = value;
 }
 BigInt<uint128_t>::BigInt(const BigInt<uint128_t>& rhs)
-    : val_(new uint128_t[rhs.cap_]),
+    : val_(nullptr),
       len_(rhs.len_),
-      cap_(rhs.cap_),
-      end_(val_ + len_) {
-    // std::memcpy(val_, rhs.val_, rhs.cap_ * sizeof(uint128_t));
-    std::copy(rhs.val_, rhs.val_ + rhs.cap_, val_);
+      cap_(SMALL_CAP),
+      end_(nullptr),
+      res_(LimbResource()) {
+    // rhs may be a view, so its capacity is not copied
+    while (cap_ <= len_) cap_ <<= 1;
+    val_ = NewLimbs(cap_, res_);
+    end_ = val_ + len_;
+    std::copy(rhs.val_, rhs.end_, val_);
+    *end_ = 0;
 }
 BigInt<uint128_t>::BigInt(BigInt<uint128_t>&& rhs) noexcept : BigInt() {
-    std::swap(val_, rhs.val_);
-    std::swap(len_, rhs.len_);
-    std::swap(cap_, rhs.cap_);
-    std::swap(end_, rhs.end_);
+    Swap(rhs);
 }
 BigInt<uint128_t>& BigInt<uint128_t>::operator=(const BigInt<uint128_t>& rhs) {
     if (this == &rhs) return *this;
@@ -40,31 +70,27 @@ BigInt<uint128_t>& BigInt<uint128_t>::operator=(const BigInt<uint128_t>& rhs) {
         // std::memcpy(val_, rhs.val_, rhs.len_ * sizeof(uint128_t));
         std::copy(rhs.val_, rhs.val_ + rhs.len_, val_);
         end_ = val_ + rhs.len_;
-        if (len_ > rhs.len_)
-            // std::memset(end_, 0, (len_ - rhs.len_) * sizeof(uint128_t));
-            std::fill(val_ + rhs.len_, val_ + len_, 0);
+        *end_ = 0;
         len_ = rhs.len_;
     } else {
-        delete[] val_;
-        val_ = new uint128_t[rhs.cap_];
-        // std::memcpy(val_, rhs.val_, rhs.cap_ * sizeof(uint128_t));
-        std::copy(rhs.val_, rhs.val_ + rhs.cap_, val_);
-        cap_ = rhs.cap_;
+        DeleteLimbs(val_, cap_);
+        while (cap_ <= rhs.len_) cap_ <<= 1;
+        res_ = LimbResource();
+        val_ = NewLimbs(cap_, res_);
         len_ = rhs.len_;
         end_ = val_ + len_;
+        std::copy(rhs.val_, rhs.end_, val_);
+        *end_ = 0;
     }
     return *this;
 }
 BigInt<uint128_t>& BigInt<uint128_t>::operator=(
     BigInt<uint128_t>&& rhs) noexcept {
     if (this == &rhs) return *this;
-    std::swap(val_, rhs.val_);
-    std::swap(len_, rhs.len_);
-    std::swap(cap_, rhs.cap_);
-    std::swap(end_, rhs.end_);
+    Swap(rhs);
     return *this;
 }
-BigInt<uint128_t>::~BigInt() { delete[] val_; }
+BigInt<uint128_t>::~BigInt() { DeleteLimbs(val_, cap_); }
 const uint128_t* BigInt<uint128_t>::Data() const { return val_; }
 uint64_t BigInt<uint128_t>::Length() const { return len_; }
 BigInt<uint128_t>::operator bool() const {
@@ -136,29 +162,28 @@ void BigInt<uint128_t>::SetLen(uint64_t new_len, bool preserve_sign) {
     }
     if (new_len > len_) {
         if (new_len >= cap_) {
+            uint64_t old_cap = cap_;
             cap_ <<= 1;
             while (cap_ <= new_len) cap_ <<= 1;
-            auto tmp_ptr = new uint128_t[cap_];
+            auto res = LimbResource();
+            auto tmp_ptr = NewLimbs(cap_, res);
             // std::memcpy(tmp_ptr, val_, (end_ - val_) * int_size);
             std::copy(val_, end_, tmp_ptr);
-            delete[] val_;
+            DeleteLimbs(val_, old_cap);
+            res_ = res;
             val_ = tmp_ptr;
             tmp_ptr = nullptr;
-            // std::memset(val_ + new_len, 0, (cap_ - new_len) * int_size);
-            std::fill(val_ + new_len, val_ + cap_, 0);
-            if (preserve_sign && sign)
-                // std::memset(val_ + len_, -1, (new_len - len_) * int_size);
-                std::fill(val_ + len_, val_ + new_len, -1);
-            else
-                // std::memset(val_ + len_, 0, (new_len - len_) * int_size);
-                std::fill(val_ + len_, val_ + new_len, 0);
-        } else {
-            if (preserve_sign && sign)
-                // std::memset(val_ + len_, -1, (new_len - len_) * int_size);
-                std::fill(val_ + len_, val_ + new_len, -1);
         }
+        // only the new limbs and the guard, the rest of cap_ is left as is
+        if (preserve_sign && sign)
+            // std::memset(val_ + len_, -1, (new_len - len_) * int_size);
+            std::fill(val_ + len_, val_ + new_len, -1);
+        else
+            // std::memset(val_ + len_, 0, (new_len - len_) * int_size);
+            std::fill(val_ + len_, val_ + new_len, 0);
         len_ = new_len;
         end_ = val_ + len_;
+        *end_ = 0;
     } else if (new_len < len_) {
         end_ = val_ + new_len;
         auto it = end_ - 1;
@@ -167,17 +192,61 @@ void BigInt<uint128_t>::SetLen(uint64_t new_len, bool preserve_sign) {
             *it >>= 1;
             if (sign) *it |= uint128_t(1) << 127;
         }
-        // std::memset(end_, 0, (len_ - new_len) * int_size);
-        std::fill(val_ + new_len, val_ + len_, 0);
+        *end_ = 0;
         if (new_len == 1) {
             end_ = val_ + 2;
             len_ = 2;
+            *end_ = 0;
             if (preserve_sign && sign) *(val_ + 1) = -1;
         } else {
             len_ = new_len;
         }
     }
 }
+void BigInt<uint128_t>::SetLenUninit(uint64_t new_len) {
+    if (new_len < 2) new_len = 2;
+    if (new_len >= cap_) {
+        DeleteLimbs(val_, cap_);
+        while (cap_ <= new_len) cap_ <<= 1;
+        res_ = LimbResource();
+        val_ = NewLimbs(cap_, res_);
+    }
+    len_ = new_len;
+    end_ = val_ + len_;
+    *end_ = 0;
+}
+void BigInt<uint128_t>::AssignDigits(const uint64_t* src, uint64_t n,
+                                     bool neg) {
+    // one more half limb for the sign
+    SetLenUninit((n >> 1) + 1);
+    auto dest = reinterpret_cast<uint64_t*>(val_);
+    auto term = reinterpret_cast<uint64_t*>(end_);
+    if (neg) {
+        // two's complement on the way in
+        uint64_t c = 1;
+        for (uint64_t i = 0; i < n; ++i) {
+            dest[i] = ~src[i] + c;
+            c &= !src[i];
+        }
+        std::fill(dest + n, term, c ? 0 : ~uint64_t(0));
+    } else {
+        std::copy(src, src + n, dest);
+        std::fill(dest + n, term, 0);
+    }
+    ShrinkLen();
+}
+const uint128_t* BigInt<uint128_t>::Magnitude(const BigInt& x) {
+    if (!x.Sign()) return x.val_;
+    auto limbs = NewScratch<uint128_t>(x.len_);
+    auto src = reinterpret_cast<const uint64_t*>(x.val_);
+    auto dest = reinterpret_cast<uint64_t*>(limbs);
+    uint64_t c = 1;
+    for (uint64_t i = 0; i < (x.len_ << 1); ++i) {
+        dest[i] = ~src[i] + c;
+        c &= !src[i];
+    }
+    return limbs;
+}
 void BigInt<uint128_t>::ShrinkLen() {
     if (len_ <= 2) return;
     --end_;
@@ -202,12 +271,15 @@ void BigInt<uint128_t>::ShrinkLen() {
 void BigInt<uint128_t>::Shrink() {
     uint64_t term = (len_ << 1) + 1;
     if (cap_ > term) {
+        uint64_t old_cap = cap_;
         do
             cap_ >>= 1;
         while (cap_ > term);
-        auto tmp_ptr = new uint128_t[cap_];
-        std::copy(val_, val_ + cap_, tmp_ptr);
-        delete[] val_;
+        auto res = LimbResource();
+        auto tmp_ptr = NewLimbs(cap_, res);
+        std::copy(val_, end_ + 1, tmp_ptr);
+        DeleteLimbs(val_, old_cap);
+        res_ = res;
         val_ = tmp_ptr;
         tmp_ptr = nullptr;
         end_ = val_ + len_;
@@ -246,6 +318,81 @@ double BigInt<uint128_t>::log2() const {
         return std::log2(double(*it)) + ((it - val_) << LOGLIMB);
 }
 double BigInt<uint128_t>::log10() const { return log2() / std::log2(10.0); }
+uint64_t BigInt<uint128_t>::DigitCount(int base) const {
+    if (base < 2 || base > 36) base = 10;
+    // |x| is read in place, t is x, or ~x with |x| = t + 1
+    bool sign = Sign();
+    auto w = reinterpret_cast<const uint64_t*>(val_);
+    uint64_t n = len_ << 1, fill = sign ? ~uint64_t(0) : 0;
+    while (n && w[n - 1] == fill) --n;
+    // 0 or -1
+    if (!n) return 1;
+    uint64_t bits = (n << 6) - __builtin_clzll(w[n - 1] ^ fill);
+    if (sign) {
+        // t + 1 carries into a new bit when t is all ones
+        uint64_t top = ~w[n - 1];
+        bool ones = !(top & (top + 1));
+        for (uint64_t i = 0; ones && i + 1 < n; ++i) ones = !w[i];
+        bits += ones;
+    }
+    if (bits <= 1) return 1;
+    if (!(base & (base - 1))) {
+        uint64_t shift = __builtin_ctz(base);
+        return (bits + shift - 1) / shift;
+    }
+    // 2^(bits-1) <= |x| < 2^bits leaves at most two candidates, widened
+    // a little against rounding
+    double lb = std::log2(double(base));
+    double eps = 1e-12 * double(bits) + 1e-9;
+    auto d = uint64_t(std::floor(double(bits - 1) / lb - eps)) + 1;
+    auto d_max = uint64_t(std::floor(double(bits) / lb + eps)) + 1;
+    if (bits <= LIMB) {
+        // pow = base^(d-1) <= x
+        uint128_t x = sign ? -*val_ : *val_, pow = 1;
+        for (uint64_t i = 1; i < d; ++i) pow *= uint64_t(base);
+        for (; d < d_max; ++d)
+            if (__builtin_mul_overflow(pow, uint128_t(base), &pow) || x < pow)
+                break;
+        return d;
+    }
+    // |x| within [top * 2^s, (top + 1) * 2^s], against p-bit bounds of
+    // base^d; the exact power only when they straddle
+    constexpr uint64_t p = 192;
+    uint64_t s = bits > p + 64 ? bits - p - 64 : 0, j = s >> 6;
+    BigInt top, lo, hi, pow;
+    top.SetLenUninit(((n - j) >> 1) + 1);
+    auto tw = reinterpret_cast<uint64_t*>(top.val_);
+    for (uint64_t i = j; i < n; ++i) tw[i - j] = w[i] ^ fill;
+    std::fill(tw + n - j, reinterpret_cast<uint64_t*>(top.end_), 0);
+    top >>= s & 63;
+    auto below = [&](const BigInt& a, const BigInt& b, uint64_t e) {
+        return s >= e ? (a << (s - e)) < b : a < (b << (e - s));
+    };
+    uint64_t e;
+    for (; d < d_max; ++d) {
+        PowerBounds(base, d, p, &lo, &hi, &e);
+        if (below(top + BigInt(1), lo, e)) break;
+        if (!below(top, hi, e)) continue;
+        pow = Power(BigInt(base), d);
+        if (!sign) {
+            if (*this < pow) break;
+            continue;
+        }
+        // t + 1 < pow, as t < pow - 1 word by word
+        --pow;
+        auto pw = reinterpret_cast<const uint64_t*>(pow.val_);
+        uint64_t pn = pow.len_ << 1;
+        while (pn && !pw[pn - 1]) --pn;
+        if (n != pn) {
+            if (n < pn) break;
+            continue;
+        }
+        uint64_t i = n;
+        while (i && ~w[i - 1] == pw[i - 1]) --i;
+        if (i && ~w[i - 1] < pw[i - 1]) break;
+    }
+    return d;
+}
 std::vector<uint8_t> BigInt<uint128_t>::Serialize() const {
     // 0 is empty vector
     if (!*this) return std::vector<uint8_t>();
@@ -265,22 +412,21 @@ std::vector<uint8_t> BigInt<uint128_t>::Serialize() const {
 }
 // input from big-endian data
 BigInt<uint128_t>::BigInt(const uint8_t* data, size_t size)
-    : len_((size >> 4) + 1), cap_(4) {
+    : len_((size >> 4) + 1), cap_(SMALL_CAP), res_(LimbResource()) {
     if (!size) {
-        val_ = new uint128_t[4];
+        val_ = small_;
         len_ = 2;
-        cap_ = 4;
         end_ = val_ + len_;
         std::fill(val_, val_ + cap_, 0);
         return;
     }
     while (cap_ <= len_) cap_ <<= 1;
-    val_ = new uint128_t[cap_];
+    val_ = NewLimbs(cap_, res_);
     if (len_ < 2) {
         len_ = 2;
     }
     end_ = val_ + len_;
-    std::fill(end_, val_ + cap_, 0);
+    *end_ = 0;
     if (data[0] >> 7)
         std::fill(val_, end_, -1);
     else
@@ -131,6 +131,15 @@ BigInt<uint128_t>& BigInt<uint128_t>::operator^=(const BigInt<uint128_t>& rhs) {
     ShrinkLen();
     return *this;
 }
+BigInt<uint128_t>& BigInt<uint128_t>::CutBit(uint64_t bitlen) {
+    // keep the lowest bitlen bits, as a non-negative number
+    uint64_t q = bitlen >> LOGLIMB, r = bitlen & (LIMB - 1);
+    if (q >= len_) SetLen(q + 1, true);
+    *(val_ + q) &= (uint128_t(1) << r) - 1;
+    SetLen(q + 1, false);
+    ShrinkLen();
+    return *this;
+}
 BigInt<uint128_t>& BigInt<uint128_t>::operator<<=(uint64_t rhs) {
     // preserve sign
     if (!rhs) return *this;
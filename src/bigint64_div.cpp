@@ -1,43 +1,73 @@
+#include <cassert>
+
 #include "bigint64.hpp"
 namespace calc {
 BigInt<uint128_t>& BigInt<uint128_t>::DivEq64(int64_t rhs, int64_t* remain) {
     // process as uint64
     auto it = end_;
     bool sign = Sign(), rhs_sign = rhs < 0;
-    int64_t mod;
+    uint64_t mod = 0;
     if (sign) ToOpposite();
     if (rhs < 0) rhs = -rhs;
-    asm("xorq %%rdx, %%rdx" : : : "rdx");
     do {
         --it;
-        asm("movq 8(%0), %%rax\n\t"
-            "divq %1\n\t"
-            "movq %%rax, 8(%0)\n\t"
-            "movq (%0), %%rax\n\t"
-            "divq %1\n\t"
-            "movq %%rax, (%0)"
-            :
-            : "r"(it), "g"(rhs)
-            : "cc", "memory", "rax", "rdx");
+        // the remainder is carried in rdx between limbs
+        asm volatile(
+            "movq 8(%1), %%rax\n\t"
+            "divq %2\n\t"
+            "movq %%rax, 8(%1)\n\t"
+            "movq (%1), %%rax\n\t"
+            "divq %2\n\t"
+            "movq %%rax, (%1)"
+            : "+d"(mod)
+            : "r"(it), "r"(rhs)
+            : "cc", "memory", "rax");
     } while (it > val_);
-    asm("movq %%rdx, %0" : "=m"(mod));
     if (sign != rhs_sign) ToOpposite();
     ShrinkLen();
     if (remain) {
         if (sign)
-            *remain = -mod;
+            *remain = -int64_t(mod);
         else
-            *remain = mod;
+            *remain = int64_t(mod);
     }
     return *this;
 }
-uint64_t BigInt<uint128_t>::DivDCore(const BigInt& rhs, uint64_t v1,
-                                     uint64_t v2, uint64_t u1h, uint64_t u1l,
-                                     uint64_t u2, uint64_t bias,
-                                     bool half_more) {
+uint64_t BigInt<uint128_t>::SubMul64(uint64_t* dest, const uint64_t* src,
+                                     uint64_t n, uint64_t q) {
+    // dest[0..n) -= src[0..n) * q, return the borrow out of dest[n-1]
+    uint64_t borrow = 0, lo, t;
+    uint128_t prod;
+    for (uint64_t i = 0; i < n; ++i) {
+        prod = uint128_t(src[i]) * q + borrow;
+        lo = prod;
+        t = dest[i];
+        dest[i] = t - lo;
+        borrow = uint64_t(prod >> 64) + (t < lo);
+    }
+    return borrow;
+}
+uint64_t BigInt<uint128_t>::AddN64(uint64_t* dest, const uint64_t* src,
+                                   uint64_t n) {
+    // dest[0..n) += src[0..n), return the carry out of dest[n-1]
+    uint128_t sum = 0;
+    for (uint64_t i = 0; i < n; ++i) {
+        sum = (sum >> 64) + dest[i] + src[i];
+        dest[i] = sum;
+    }
+    return sum >> 64;
+}
+uint64_t BigInt<uint128_t>::DivDCore(uint64_t* u, const uint64_t* v,
+                                     uint64_t n, uint64_t v1, uint64_t v2,
+                                     uint64_t u1h, uint64_t u1l, uint64_t u2) {
+    // u[0..n] is the current window of the dividend, v[0..n) the divisor,
+    // v1, v2, u1h, u1l, u2 are the top digits as if both were normalized
     uint64_t q, r;
+    bool test = true;
     if (u1h >= v1) {
         q = -1;
+        r = u1l + v1;
+        test = r >= v1;  // r < 2^64
     } else {
         asm("movq %2, %%rdx\n\t"
             "movq %3, %%rax\n\t"
@@ -48,25 +78,41 @@ uint64_t BigInt<uint128_t>::DivDCore(const BigInt& rhs, uint64_t v1,
             : "=m"(q), "=m"(r)
             : "m"(u1h), "m"(u1l), "m"(v1)
             : "memory", "rax", "rdx");
-        if (uint128_t(q) * v2 > ((uint128_t(r) << 64) | u2)) --q;
     }
-    BiasedSubEq(rhs * q, bias, half_more);
-    if (Sign()) {
+    // now q is at most 2 larger than the real one,
+    // and after the test at most 1 larger
+    if (test) {
+        while (uint128_t(q) * v2 > ((uint128_t(r) << 64) | u2)) {
+            --q;
+            r += v1;
+            if (r < v1) break;
+        }
+    }
+    uint64_t borrow = SubMul64(u, v, n, q);
+    if (u[n] < borrow) {
         --q;
-        BiasedAddEq(rhs, bias, half_more);
+        u[n] += AddN64(u, v, n);
     }
+    u[n] -= borrow;
     return q;
 }
 BigInt<uint128_t>& BigInt<uint128_t>::DivEqD(const BigInt& rhs, BigInt* mod) {
     // reinterpret as uint64
     if (!rhs) return *this;
-    if (rhs.Sign()) {
-        DivEqD(-rhs, mod);
-        return ToOpposite();
-    }
-    bool sign = Sign();
+    // on the magnitudes, the quotient is negated if the signs differ and
+    // the remainder takes the sign of the dividend
+    bool sign = Sign(), rhs_sign = rhs.Sign();
+    uint64_t rlen = rhs.len_;
+    auto mv = Magnitude(rhs);
+    auto v = reinterpret_cast<const uint64_t*>(mv);
+    uint64_t n = rlen << 1;
+    while (!v[n - 1]) --n;
     if (sign) ToOpposite();
-    if (*this < rhs) {
+    auto u = reinterpret_cast<uint64_t*>(val_);
+    uint64_t ud = len_ << 1;
+    while (ud && !u[ud - 1]) --ud;
+    if (Less64(u, ud, v, n)) {
+        if (rhs_sign) DeleteScratch(mv, rlen);
         if (mod) {
             if (sign) ToOpposite();
             *mod = std::move(*this);
@@ -74,133 +120,49 @@ BigInt<uint128_t>& BigInt<uint128_t>::DivEqD(const BigInt& rhs, BigInt* mod) {
         SetLen(0, false);
         return *this;
     }
-    auto testit = rhs.end_ - 1;
-    BigInt<uint128_t> rv;
-    uint64_t rlen = len_ - rhs.len_ + 2;
-    while (!*testit) {
-        --testit;
-        ++rlen;
+    // need a zero digit on top of the dividend
+    if (ud == len_ << 1) {
+        SetLen(len_ + 1, false);
+        u = reinterpret_cast<uint64_t*>(val_);
     }
-    rv.SetLen(rlen, false);
+    // dividend and divisor are never really shifted,
+    // only the digits for estimation are
     uint64_t mov;
-    if (*testit >> 64) {
-        asm("bsrq 8(%1), %%r9\n\tmovq %%r9, %0"
-            : "=m"(mov)
-            : "r"(testit)
-            : "cc", "memory", "r9");
-        mov = 63 - mov;
-    } else {
-        asm("bsrq (%1), %%r9\n\tmovq %%r9, %0"
-            : "=m"(mov)
-            : "r"(testit)
-            : "cc", "memory", "r9");
-        mov = 127 - mov;
-    }
-    // no real move
-    uint128_t tmpv = *testit << mov;
-    if (testit > rhs.val_ && mov) tmpv |= *(testit - 1) >> (128 - mov);
-    uint64_t v1 = tmpv >> 64, v2 = tmpv;
-    uint64_t i = len_;
-    auto rit = rv.val_ + len_ - (testit - rhs.val_);
-    if (!val_[i - 1]) {
-        --i;
-        --rit;
-    }
-    auto rterm = rv.val_;
-    if (testit <= rhs.val_) ++rterm;
-    uint64_t u1h, u1l, u2;
-    uint128_t t1, t2, t3;
-
-    // the loop
+    asm("bsrq %1, %0" : "=r"(mov) : "rm"(v[n - 1]) : "cc");
+    mov = 63 - mov;
+    uint64_t v1 = v[n - 1], v2 = n >= 2 ? v[n - 2] : 0;
     if (mov) {
-        while (rit > rterm) {
-            --rit;
-            --i;
-
-            // high
-            t1 = val_[i + 1];
-            t2 = val_[i];
-            t3 = val_[i - 1];
-            t1 = (t1 << mov) | (t2 >> (128 - mov));
-            t2 = (t2 << mov) | (t3 >> (128 - mov));
-            u1h = t1 >> 64;
-            u1l = t1;
-            u2 = t2 >> 64;
-            *rit = DivDCore(rhs, v1, v2, u1h, u1l, u2, rit - rv.val_, true);
-            *rit <<= 64;
-
-            // low
-            t1 = val_[i + 1];
-            t2 = val_[i];
-            t3 = val_[i - 1];
-            t1 = (t1 << mov) | (t2 >> (128 - mov));
-            t2 = (t2 << mov) | (t3 >> (128 - mov));
-            u1h = t1;
-            u1l = t2 >> 64;
-            u2 = t2;
-            *rit |= DivDCore(rhs, v1, v2, u1h, u1l, u2, rit - rv.val_, false);
-        }
-    } else {
-        // mov>=width is UB
-        while (rit > rterm) {
-            --rit;
-            --i;
-
-            // high
-            t1 = val_[i + 1];
-            t2 = val_[i];
-            u1h = t1 >> 64;
-            u1l = t1;
-            u2 = t2 >> 64;
-            *rit = DivDCore(rhs, v1, v2, u1h, u1l, u2, rit - rv.val_, true);
-            *rit <<= 64;
-
-            // low, must re-extract
-            t1 = val_[i + 1];
-            t2 = val_[i];
-            u1h = t1;
-            u1l = t2 >> 64;
-            u2 = t2;
-            *rit |= DivDCore(rhs, v1, v2, u1h, u1l, u2, rit - rv.val_, false);
-        }
+        v1 = (v1 << mov) | (v2 >> (64 - mov));
+        v2 = (v2 << mov) | (n >= 3 ? v[n - 3] >> (64 - mov) : 0);
     }
-    if (testit <= rhs.val_) {
-        // one more loop without t3
-        --rit;
-        --i;
-
-        // high
-        t1 = val_[i + 1];
-        t2 = val_[i];
-        if (mov) {
-            t1 = (t1 << mov) | (t2 >> (128 - mov));
-            t2 <<= mov;
-        }
-        u1h = t1 >> 64;
-        u1l = t1;
-        u2 = t2 >> 64;
-        *rit = DivDCore(rhs, v1, v2, u1h, u1l, u2, rit - rv.val_, true);
-        *rit <<= 64;
-
-        // low
-        t1 = val_[i + 1];
-        t2 = val_[i];
+    // the only allocation
+    BigInt<uint128_t> rv;
+    rv.SetLen(((ud - n + 2) >> 1) + 1, false);
+    auto rit = reinterpret_cast<uint64_t*>(rv.val_);
+    uint64_t u1h, u1l, u2, u3;
+    uint64_t i = ud, j = ud - n + 1;
+    do {
+        --j;
+        u1h = u[i];
+        u1l = u[i - 1];
+        u2 = i >= 2 ? u[i - 2] : 0;
         if (mov) {
-            t1 = (t1 << mov) | (t2 >> (128 - mov));
-            t2 <<= mov;
+            u3 = i >= 3 ? u[i - 3] : 0;
+            u1h = (u1h << mov) | (u1l >> (64 - mov));
+            u1l = (u1l << mov) | (u2 >> (64 - mov));
+            u2 = (u2 << mov) | (u3 >> (64 - mov));
         }
-        u1h = t1;
-        u1l = t2 >> 64;
-        u2 = t2;
-        *rit |= DivDCore(rhs, v1, v2, u1h, u1l, u2, rit - rv.val_, false);
-    }
+        rit[j] = DivDCore(u + j, v, n, v1, v2, u1h, u1l, u2);
+        --i;
+    } while (j);
+    if (rhs_sign) DeleteScratch(mv, rlen);
     if (mod) {
         *mod = std::move(*this);
         if (sign) mod->ToOpposite();
         mod->ShrinkLen();
     }
     *this = std::move(rv);
-    if (sign) ToOpposite();
+    if (sign != rhs_sign) ToOpposite();
     ShrinkLen();
     return *this;
 }
@@ -208,13 +170,11 @@ BigInt<uint128_t>& BigInt<uint128_t>::operator/=(int64_t rhs) {
     return DivEq64(rhs, nullptr);
 }
 BigInt<uint128_t>& BigInt<uint128_t>::DivEq(const BigInt& rhs, BigInt* mod) {
-    // if (rhs.len_ > 16 && len_ * 2 > rhs.len_ * 3 && len_ < rhs.len_ * 3)
-    if (rhs.len_ > 16 && len_ * 2 > rhs.len_ * 3)
+    // both the divisor and the quotient need to be long enough
+    if (rhs.len_ << 1 > DIV_BZ_LIMIT && len_ > rhs.len_ + (DIV_BZ_LIMIT >> 1))
         return DivEqR(rhs, mod);
-    else if (rhs.len_ < 512 || len_ < rhs.len_ + 512)
-        return DivEqD(rhs, mod);
     else
-        return DivEqR(rhs, mod);
+        return DivEqD(rhs, mod);
 }
 BigInt<uint128_t>& BigInt<uint128_t>::operator/=(const BigInt& rhs) {
     return DivEq(rhs, nullptr);
@@ -236,68 +196,282 @@ BigInt<uint128_t>& BigInt<uint128_t>::operator%=(int64_t rhs) {
     *val_ |= mod;
     return *this;
 }
-void BigInt<uint128_t>::DivRNormal(const BigInt& rhs, BigInt* mod) {
-    // normalized: all positive, quotinent not zero,
-    // bitlen of rhs divisible by 256
-    auto cit = rhs.end_ - 1;
-    while (!*cit) --cit;
-    // uint64_t t = (cit - rhs.val_ + 1) >> 1;
-    uint64_t t = (cit - rhs.val_ + 1);
-    t >>= 1;
-    uint64_t k = (len_ + t - 1) / t;
-    BigInt<uint128_t> u, v;
-    BigInt<uint128_t> rv;
-    cit = rhs.val_ + t;
-    v.SetLen(rhs.end_ - cit, false);
-    std::copy(cit, rhs.end_, v.val_);
-    auto term = end_;
-    uint64_t i = k - 1;
-    auto it = val_ + i * t;
-    u.SetLen(term - it, false);
-    std::copy(it, term, u.val_);
-    u /= v;
-    BiasedSubEq(rhs * u, (i - 1) * t, false);
-    if (Sign()) {
-        --u;
-        BiasedAddEq(rhs, (i - 1) * t, false);
+uint64_t BigInt<uint128_t>::InvMod64(uint64_t x) {
+    // x must be odd, Newton iteration on 2-adic inverse
+    uint64_t inv = x;  // x*x=1 (mod 8), 3 bits correct
+    for (int i = 0; i < 5; ++i) inv *= 2 - x * inv;
+    return inv;
+}
+BigInt<uint128_t>& BigInt<uint128_t>::DivExactEq(uint64_t rhs) {
+    // Hensel division from the low end, no remainder is computed
+    assert(rhs);
+    // unchanged like DivEqD if NDEBUG
+    if (!rhs) return *this;
+    uint64_t tz;
+    asm("bsfq %1, %0" : "=r"(tz) : "rm"(rhs) : "cc");
+    if (tz) {
+        *this >>= tz;
+        rhs >>= tz;
     }
-    if (Sign()) {
-        --u;
-        BiasedAddEq(rhs, (i - 1) * t, false);
+    if (rhs == 1) return *this;
+#ifndef NDEBUG
+    BigInt<uint128_t> save(*this);
+#endif
+    bool sign = Sign();
+    if (sign) ToOpposite();
+    auto u = reinterpret_cast<uint64_t*>(val_);
+    auto term = reinterpret_cast<uint64_t*>(end_);
+    uint64_t inv = InvMod64(rhs);
+    uint64_t borrow = 0, t, q;
+    for (; u != term; ++u) {
+        t = *u - borrow;
+        borrow = t > *u;
+        q = t * inv;
+        *u = q;
+        borrow += (uint128_t(q) * rhs) >> 64;
     }
-    rv.BiasedAddEq(u, (i - 1) * t, false);
-    term = end_;
-    for (--i; i > 0; --i) {
-        it = val_ + i * t;
-        u.SetLen(term - it + 1, false);
-        *(u.end_ - 1) = 0;
-        std::copy(it, term, u.val_);
-        u.ShrinkLen();
-        u /= v;
-        BiasedSubEq(rhs * u, (i - 1) * t, false);
-        if (Sign()) {
-            --u;
-            BiasedAddEq(rhs, (i - 1) * t, false);
-        }
-        if (Sign()) {
-            --u;
-            BiasedAddEq(rhs, (i - 1) * t, false);
+    if (sign) ToOpposite();
+    ShrinkLen();
+#ifndef NDEBUG
+    assert(*this * rhs == save);
+#endif
+    return *this;
+}
+void BigInt<uint128_t>::DivHensel64(uint64_t* q, uint64_t* u,
+                                    const uint64_t* v, uint64_t n,
+                                    uint64_t w) {
+    // a short v keeps to the schoolbook, linear in w
+    while (w > DIV_BZ_LIMIT && n << 1 > DIV_BZ_LIMIT) {
+        // the low part, then its whole product off the rest; the low
+        // digits of the product equal those of u, so they are put back
+        // first. Blocks of n digits for a long quotient, halves otherwise
+        uint64_t lo = w > n << 1 ? n : w >> 1;
+        auto save = NewScratch<uint64_t>(lo);
+        std::copy(u, u + lo, save);
+        DivHensel64(q, u, v, n, lo);
+        std::copy(save, save + lo, u);
+        DeleteScratch(save, lo);
+        SubProd64(u, w, q, lo, v, std::min(n, w));
+        q += lo;
+        u += lo;
+        w -= lo;
+    }
+    // schoolbook from the low end, v cut to the digits that matter
+    uint64_t inv = InvMod64(*v);
+    uint64_t m, borrow, t, k;
+    for (uint64_t i = 0; i < w; ++i) {
+        q[i] = u[i] * inv;
+        m = std::min(n, w - i);
+        borrow = SubMul64(u + i, v, m, q[i]);
+        for (k = i + m; borrow && k < w; ++k) {
+            t = u[k];
+            u[k] = t - borrow;
+            borrow = t < borrow;
         }
-        rv.BiasedAddEq(u, (i - 1) * t, false);
-        term = val_ + (i + 1) * t;
     }
-    if (mod) *mod = std::move(*this);
-    *this = std::move(rv);
 }
-BigInt<uint128_t>& BigInt<uint128_t>::DivEqR(const BigInt& rhs, BigInt* mod) {
+BigInt<uint128_t>& BigInt<uint128_t>::DivExactEq(const BigInt& rhs) {
+    // Jebelean's bidirectional exact division, the low digits of the
+    // quotient by Hensel division from the low end, the high digits by
+    // dividing the leading digits, overlapping by one digit
+    assert(rhs);
     if (!rhs) return *this;
     if (rhs.Sign()) {
-        DivEqD(-rhs, mod);
+        DivExactEq(-rhs);
         return ToOpposite();
     }
+    auto v = reinterpret_cast<const uint64_t*>(rhs.val_);
+    uint64_t n = rhs.len_ << 1;
+    while (!v[n - 1]) --n;
+    if (n == 1) return DivExactEq(*v);
+    if (!*v || !(*v & 1)) {
+        // divisor must be odd
+        auto tz = rhs.TrailingZero();
+        *this >>= tz;
+        return DivExactEq(rhs >> tz);
+    }
+#ifndef NDEBUG
+    BigInt<uint128_t> save(*this);
+#endif
     bool sign = Sign();
     if (sign) ToOpposite();
-    if (*this < rhs) {
+    auto u = reinterpret_cast<uint64_t*>(val_);
+    uint64_t ud = len_ << 1;
+    while (ud && !u[ud - 1]) --ud;
+    if (ud < n) {
+        // only 0 is divisible by a larger number
+        SetLen(0, false);
+        return *this;
+    }
+    uint64_t qn = ud - n + 1;
+    // half of the quotient from each end: the high half by DivEq on the
+    // leading digits, the low half and the overlap by Hensel division with
+    // the low digits of v. Past n digits v can not be cut any more and a
+    // Hensel block costs more than one of DivEq, so the bottom takes at
+    // most n; short quotients are all from the bottom
+    uint64_t ql = qn <= DIV_BZ_LIMIT ? qn : std::min(qn >> 1, n),
+             qh = qn - ql, w = qh ? ql + 1 : ql;
+    BigInt<uint128_t> high;
+    if (qh) {
+        // off by at most one when v is cut to qh+2 digits
+        uint64_t s = n > qh + 2 ? n - qh - 2 : 0;
+        BigInt<uint128_t> vt;
+        high.AssignDigits(u + ql + s, ud - ql - s);
+        vt.AssignDigits(v + s, n - s);
+        high.DivEq(vt, nullptr);
+    }
+    // the low digits and the overlap only depend on the low digits of v
+    auto q = NewScratch<uint64_t>(w);
+    DivHensel64(q, u, v, n, w);
+    std::copy(q, q + w, u);
+    DeleteScratch(q, w);
+    if (qh) {
+        // the overlap digit picks the right one out of three
+        auto h = reinterpret_cast<uint64_t*>(high.val_);
+        if (h[0] + 1 == u[ql])
+            ++high;
+        else if (h[0] - 1 == u[ql])
+            --high;
+        high.SetLen((qh >> 1) + 1, false);
+        h = reinterpret_cast<uint64_t*>(high.val_);
+        std::copy(h, h + qh, u + ql);
+    }
+    // high digits are known to be cancelled
+    std::fill(u + qn, u + (len_ << 1), 0);
+    if (sign) ToOpposite();
+    ShrinkLen();
+#ifndef NDEBUG
+    assert(*this * rhs == save);
+#endif
+    return *this;
+}
+bool BigInt<uint128_t>::Less64(const uint64_t* a, uint64_t an,
+                               const uint64_t* b, uint64_t bn) {
+    if (an != bn) return an < bn;
+    while (an && a[an - 1] == b[an - 1]) --an;
+    return an && a[an - 1] < b[an - 1];
+}
+uint64_t BigInt<uint128_t>::SubN64(uint64_t* dest, const uint64_t* src,
+                                   uint64_t n) {
+    // dest[0..n) -= src[0..n), return the borrow out of dest[n-1]
+    uint64_t borrow = 0, t, d;
+    for (uint64_t i = 0; i < n; ++i) {
+        t = dest[i];
+        d = t - src[i];
+        dest[i] = d - borrow;
+        borrow = (t < src[i]) | (d < borrow);
+    }
+    return borrow;
+}
+uint64_t BigInt<uint128_t>::SubProd64(uint64_t* u, uint64_t un,
+                                      const uint64_t* a, uint64_t an,
+                                      const uint64_t* b, uint64_t bn) {
+    // u[0..un) -= a*b, return the borrow out of u[un-1]
+    // a*b must fit in un digits
+    uint64_t pn, borrow;
+    // the padded top block of a quotient is mostly zero
+    while (an && !a[an - 1]) --an;
+    while (bn && !b[bn - 1]) --bn;
+    if (!an || !bn) return 0;
+    pn = an + bn;
+    if (an < bn) {
+        std::swap(a, b);
+        std::swap(an, bn);
+    }
+    // the digits are multiplied where they are, no copies
+    auto p = NewScratch<uint64_t>(an + bn);
+    if (bn < MUL_KARA_LIMIT) {
+        MulBase64(p, a, an, b, bn);
+    } else if (bn < MUL_FFT_LIMIT) {
+        auto kt = NewScratch<uint64_t>(6 * an + 256);
+        MulKara64(p, a, an, b, bn, kt);
+        DeleteScratch(kt, 6 * an + 256);
+    } else {
+        MulFFT64(p, a, an, b, bn);
+    }
+    if (pn > un) pn = un;
+    borrow = SubN64(u, p, pn);
+    DeleteScratch(p, an + bn);
+    for (uint64_t k = pn; borrow && k < un; ++k) borrow = !u[k]--;
+    return borrow;
+}
+void BigInt<uint128_t>::DivSchool64(uint64_t* q, uint64_t* u, uint64_t qn,
+                                    const uint64_t* v, uint64_t n) {
+    // {u, qn+n} / {v, n}, v normalized and u[qn..qn+n) < v,
+    // remainder left in u[0..n)
+    uint64_t v1 = v[n - 1], v2 = n >= 2 ? v[n - 2] : 0;
+    uint64_t i = qn + n - 1, j = qn;
+    do {
+        --j;
+        q[j] = DivDCore(u + j, v, n, v1, v2, u[i], u[i - 1],
+                        i >= 2 ? u[i - 2] : 0);
+        --i;
+    } while (j);
+}
+uint64_t BigInt<uint128_t>::DivBZ64(uint64_t* q, uint64_t* u,
+                                    const uint64_t* v, uint64_t n) {
+    // Burnikel-Ziegler 2n/n division, {u, 2n} / {v, n}, v normalized
+    // q[0..n) and the returned high digit (0 or 1) is the quotient,
+    // remainder in u[0..n), u[n..2n) is destroyed
+    if (n < DIV_BZ_LIMIT) {
+        uint64_t qh = 1, k = n;
+        do {
+            --k;
+            if (u[n + k] != v[k]) {
+                qh = u[n + k] > v[k];
+                break;
+            }
+        } while (k);
+        if (qh) SubN64(u + n, v, n);
+        DivSchool64(q, u, n, v, n);
+        return qh;
+    }
+    uint64_t lo = n >> 1, hi = n - lo, cy, qh, ql;
+    // 3n/2n with the upper halves
+    qh = DivBZ64(q + lo, u + (lo << 1), v + lo, hi);
+    cy = SubProd64(u + lo, n, q + lo, hi, v, lo);
+    if (qh) cy += SubN64(u + n, v, lo);
+    while (cy) {
+        // qhat is at most 2 larger
+        uint64_t k = lo;
+        while (k < n && !q[k]--) ++k;
+        if (k == n) qh = 0;
+        cy -= AddN64(u + lo, v, n);
+    }
+    // 3n/2n with the lower halves
+    ql = DivBZ64(q, u + hi, v + hi, lo);
+    cy = SubProd64(u, n, v, hi, q, lo);
+    if (ql) cy += SubN64(u + lo, v, hi);
+    while (cy) {
+        uint64_t k = 0;
+        while (k < lo && !q[k]--) ++k;
+        cy -= AddN64(u, v, n);
+    }
+    return qh;
+}
+BigInt<uint128_t>& BigInt<uint128_t>::DivEqR(const BigInt& rhs, BigInt* mod) {
+    if (!rhs) return *this;
+    // on the magnitudes, like DivEqD
+    bool sign = Sign(), rhs_sign = rhs.Sign();
+    uint64_t rlen = rhs.len_;
+    // the products of SubProd64 take at most this much scratch at a time,
+    // next to the magnitude of rhs
+    ScratchScope scope(MulScratch(rlen + 4) +
+                       (18 * rlen + 256) * sizeof(uint64_t));
+    auto mv = Magnitude(rhs);
+    auto v = reinterpret_cast<const uint64_t*>(mv);
+    uint64_t n = rlen << 1;
+    while (!v[n - 1]) --n;
+    if (n < DIV_BZ_LIMIT) {
+        if (rhs_sign) DeleteScratch(mv, rlen);
+        return DivEqD(rhs, mod);
+    }
+    if (sign) ToOpposite();
+    auto u = reinterpret_cast<uint64_t*>(val_);
+    uint64_t ud = len_ << 1;
+    while (ud && !u[ud - 1]) --ud;
+    if (Less64(u, ud, v, n)) {
+        if (rhs_sign) DeleteScratch(mv, rlen);
         if (mod) {
             if (sign) ToOpposite();
             *mod = std::move(*this);
@@ -305,44 +479,46 @@ BigInt<uint128_t>& BigInt<uint128_t>::DivEqR(const BigInt& rhs, BigInt* mod) {
         SetLen(0, false);
         return *this;
     }
-    auto testit = rhs.end_ - 1;
-    while (!*testit) {
-        --testit;
+    // normalize, the divisor has to be copied
+    uint64_t mov;
+    asm("bsrq %1, %0" : "=r"(mov) : "rm"(v[n - 1]) : "cc");
+    mov = 63 - mov;
+    uint64_t* norm_v = nullptr;
+    if (mov) {
+        norm_v = NewScratch<uint64_t>(n);
+        for (uint64_t i = n - 1; i; --i)
+            norm_v[i] = (v[i] << mov) | (v[i - 1] >> (64 - mov));
+        norm_v[0] = v[0] << mov;
+        v = norm_v;
+        *this <<= mov;
     }
-    if (testit <= rhs.val_ + 2) {
-        DivEqD(rhs, mod);
-    } else {
-        uint64_t mov;
-        if (*testit >> 64) {
-            asm("bsrq 8(%1), %%r9\n\tmovq %%r9, %0"
-                : "=m"(mov)
-                : "r"(testit)
-                : "cc", "memory", "r9");
-            mov = 63 - mov;
-        } else {
-            asm("bsrq (%1), %%r9\n\tmovq %%r9, %0"
-                : "=m"(mov)
-                : "r"(testit)
-                : "cc", "memory", "r9");
-            mov = 127 - mov;
-        }
-        if (!((testit - rhs.val_) & 1)) mov += 128;
-        // normalized
-        if (mov) {
-            *this <<= mov;
-            DivRNormal(rhs << mov, mod);
-            if (mod) *mod >>= mov;
-        } else {
-            DivRNormal(rhs, mod);
-        }
+    u = reinterpret_cast<uint64_t*>(val_);
+    ud = len_ << 1;
+    while (!u[ud - 1]) --ud;
+    uint64_t k = ud / n, r = ud - k * n;
+    // leading r+1 digits by schoolbook if few, or else pad a full block
+    bool school = r < DIV_BZ_LIMIT;
+    SetLen(((school ? ud + 1 : (k + 1) * n) >> 1) + 1, false);
+    u = reinterpret_cast<uint64_t*>(val_);
+    BigInt<uint128_t> rv;
+    rv.SetLen(((ud + n) >> 1) + 2, false);
+    auto q = reinterpret_cast<uint64_t*>(rv.val_);
+    if (school) {
+        --k;
+        DivSchool64(q + k * n, u + k * n, r + 1, v, n);
     }
-    if (sign) {
-        ToOpposite();
-        if (mod) {
-            mod->ToOpposite();
-            mod->ShrinkLen();
-        }
+    for (; k > 0; --k) DivBZ64(q + (k - 1) * n, u + (k - 1) * n, v, n);
+    if (norm_v) DeleteScratch(norm_v, n);
+    if (rhs_sign) DeleteScratch(mv, rlen);
+    std::fill(u + n, u + (len_ << 1), 0);
+    if (mod) {
+        *mod = std::move(*this);
+        if (mov) *mod >>= mov;
+        if (sign) mod->ToOpposite();
+        mod->ShrinkLen();
     }
+    *this = std::move(rv);
+    if (sign != rhs_sign) ToOpposite();
     ShrinkLen();
     return *this;
 }
@@ -0,0 +1,131 @@
+#include "bigint64.hpp"
+namespace calc {
+void BigInt<uint128_t>::AssignSum(const BigIntTerm* terms, uint64_t n) {
+    // products accumulated in place: non-negative, not this, and short
+    // enough that PlainMulEq would take them row by row anyway
+    auto accumulated = [this](const BigIntTerm& t) {
+        return !t.a->Sign() && !t.b->Sign() && t.a != this && t.b != this &&
+               std::min(t.a->len_, t.b->len_) <= (MUL_KARA_LIMIT >> 1);
+    };
+    if (n == 1 && terms->b && !accumulated(*terms)) {
+        // a plain product, formed in this storage
+        auto other = terms->b;
+        if (terms->b == this)
+            other = terms->a;
+        else if (terms->a != this)
+            *this = *terms->a;
+        if (other == this)
+            *this *= BigInt(*this);
+        else
+            *this *= *other;
+        if (terms->neg) ToOpposite();
+        return;
+    }
+    // long products are formed first, while the operands are intact
+    std::vector<BigInt> products;
+    uint64_t len = 2;
+    for (uint64_t i = 0; i < n; ++i) {
+        auto& t = terms[i];
+        if (!t.b) {
+            len = std::max(len, t.a->len_);
+        } else if (accumulated(t)) {
+            len = std::max(len, t.a->len_ + t.b->len_);
+        } else {
+            if (products.empty()) products.reserve(n);
+            products.push_back(*t.a * *t.b);
+            len = std::max(len, products.back().len_);
+        }
+    }
+    // one more limb for the carries of up to 2^127 terms
+    SetLen(len + 1, true);
+    struct Addend {
+        const uint64_t* digits;
+        uint64_t n;
+        // the digits past n
+        uint64_t ext;
+    };
+    // added terms first, then the subtracted ones from sub
+    auto addends = NewScratch<Addend>(n);
+    uint64_t m = 0, sub = n, common = len_ << 1;
+    bool this_only = true;
+    for (uint64_t i = 0, k = 0; i < n; ++i) {
+        auto& t = terms[i];
+        if (t.b && accumulated(t)) continue;
+        auto x = t.b ? &products[k++] : t.a;
+        Addend addend = {reinterpret_cast<const uint64_t*>(x->val_),
+                         x->len_ << 1, x->Sign() ? ~uint64_t(0) : 0};
+        common = std::min(common, addend.n);
+        if (t.neg)
+            addends[--sub] = addend;
+        else
+            addends[m++] = addend;
+        this_only = this_only && x == this && !t.neg;
+    }
+    auto d = reinterpret_cast<uint64_t*>(val_);
+    uint64_t dn = len_ << 1;
+    // this + (accumulated products) needs no pass over the digits
+    if (!this_only || m != 1) {
+        // every digit of the terms is read before d[j] is written, so this
+        // may be one of them
+        // apart from Addend, as stores to d may alias its fields
+        auto digits = NewScratch<const uint64_t*>(n);
+        for (uint64_t k = 0; k < n; ++k)
+            if (k < m || k >= sub) digits[k] = addends[k].digits;
+        int128_t carry = 0;
+        uint64_t j = 0;
+        for (; j < common; ++j) {
+            uint128_t plus = 0, minus = 0;
+            for (uint64_t k = 0; k < m; ++k) plus += digits[k][j];
+            for (uint64_t k = sub; k < n; ++k) minus += digits[k][j];
+            carry += int128_t(plus) - int128_t(minus);
+            d[j] = uint64_t(carry);
+            carry >>= 64;
+        }
+        for (; j < dn; ++j) {
+            uint128_t plus = 0, minus = 0;
+            for (uint64_t k = 0; k < m; ++k) {
+                auto& x = addends[k];
+                plus += j < x.n ? digits[k][j] : x.ext;
+            }
+            for (uint64_t k = sub; k < n; ++k) {
+                auto& x = addends[k];
+                minus += j < x.n ? digits[k][j] : x.ext;
+            }
+            carry += int128_t(plus) - int128_t(minus);
+            d[j] = uint64_t(carry);
+            carry >>= 64;
+        }
+        DeleteScratch(digits, n);
+    }
+    DeleteScratch(addends, n);
+    for (uint64_t i = 0; i < n; ++i) {
+        auto& t = terms[i];
+        if (!t.b || !accumulated(t)) continue;
+        auto a = reinterpret_cast<const uint64_t*>(t.a->val_);
+        auto b = reinterpret_cast<const uint64_t*>(t.b->val_);
+        uint64_t an = t.a->len_ << 1, bn = t.b->len_ << 1;
+        while (an && !a[an - 1]) --an;
+        while (bn && !b[bn - 1]) --bn;
+        if (an < bn) {
+            std::swap(a, b);
+            std::swap(an, bn);
+        }
+        // row by row, the carry of each row rippled to the top
+        for (uint64_t r = 0; r < bn; ++r) {
+            uint64_t c, k = r + an;
+            if (t.neg) {
+                c = SubMul64(d + r, a, an, b[r]);
+                for (; c && k < dn; ++k) {
+                    uint64_t x = d[k];
+                    d[k] = x - c;
+                    c = x < c;
+                }
+            } else {
+                c = AddMul64(d + r, a, an, b[r]);
+                for (; c && k < dn; ++k) c = (d[k] += c) < c;
+            }
+        }
+    }
+    ShrinkLen();
+}
+}  // namespace calc
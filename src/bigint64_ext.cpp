@@ -226,7 +226,11 @@ BigInt<uint128_t> PowMod(const BigInt<uint128_t>& a, const BigInt<uint128_t>& p,
                          const BigInt<uint128_t>& n) {
     if (p.Sign()) return BigInt<uint128_t>(0);
     if (!p) return BigInt<uint128_t>(1);
+    if (SpecialModulus::Detect(n)) return PowMod(a, p, SpecialModulus(n));
     if (a > n) return PowMod(a % n, p, n);
+    // squares and products of up to 2n limbs, then their division by n
+    ScratchScope scope(MulScratch(2 * n.len_ + 2) +
+                       (12 * n.len_ + 256) * sizeof(uint64_t));
     uint128_t mask = uint128_t(1) << (a.LIMB - 1);
     for (; mask; mask >>= 1)
         if (p.val_[p.len_ - 1] & mask) break;
@@ -244,7 +248,12 @@ BigInt<uint128_t> PowMod(const BigInt<uint128_t>& a, const BigInt<uint128_t>& p,
 BigInt<uint128_t> PowMod(const BigInt<uint128_t>& a, uint64_t p,
                          const BigInt<uint128_t>& n) {
     if (!p) return BigInt<uint128_t>(1);
+    if (SpecialModulus::Detect(n))
+        return PowMod(a, BigInt<uint128_t>(p), SpecialModulus(n));
     if (a > n) return PowMod(a % n, p, n);
+    // squares and products of up to 2n limbs, then their division by n
+    ScratchScope scope(MulScratch(2 * n.len_ + 2) +
+                       (12 * n.len_ + 256) * sizeof(uint64_t));
     uint64_t mask = 1ul << 63ul;
     for (; mask; mask >>= 1)
         if (p & mask) break;
@@ -257,6 +266,126 @@ BigInt<uint128_t> PowMod(const BigInt<uint128_t>& a, uint64_t p,
     }
     return std::move(result) % n;
 }
+BigInt<uint128_t> PowMod(const BigInt<uint128_t>& a, const BigInt<uint128_t>& p,
+                         const SpecialModulus& n) {
+    if (p.Sign()) return BigInt<uint128_t>(0);
+    if (!p) return BigInt<uint128_t>(1);
+    // squares and products of up to 2n limbs, then their division by n
+    ScratchScope scope(MulScratch(2 * n.Value().len_ + 2) +
+                       (12 * n.Value().len_ + 256) * sizeof(uint64_t));
+    BigInt<uint128_t> base(a);
+    n.Reduce(base);
+    uint128_t mask = uint128_t(1) << (a.LIMB - 1);
+    for (; mask; mask >>= 1)
+        if (p.val_[p.len_ - 1] & mask) break;
+    BigInt<uint128_t> result(1);
+    for (size_t i = p.len_ - 1; i != size_t(-1); --i) {
+        for (; mask; mask >>= 1) {
+            result.SquareEq();
+            n.Reduce(result);
+            if (p.val_[i] & mask) n.Reduce(result *= base);
+        }
+        mask = uint128_t(1) << (a.LIMB - 1);
+    }
+    // same sign as a^p % n
+    if (a.Sign() && p.Parity() && result) result -= n.Value();
+    return result;
+}
+BigInt<uint128_t> MulMod(const BigInt<uint128_t>& a, const BigInt<uint128_t>& b,
+                         const BigInt<uint128_t>& n) {
+    if (!SpecialModulus::Detect(n)) return a * b % n;
+    return MulMod(a, b, SpecialModulus(n));
+}
+BigInt<uint128_t> MulMod(const BigInt<uint128_t>& a, const BigInt<uint128_t>& b,
+                         const SpecialModulus& n) {
+    auto result = n.MulMod(a, b);
+    // same sign as a * b % n
+    if (a.Sign() != b.Sign() && result) result -= n.Value();
+    return result;
+}
+SpecialModulus::SpecialModulus(uint64_t k, int64_t c)
+    : n_(BigInt<uint128_t>(1) << k), k_(k), c_(c) {
+    if (c >= 0)
+        n_ -= uint64_t(c);
+    else
+        n_ += uint64_t(-c);
+}
+SpecialModulus::SpecialModulus(const BigInt<uint128_t>& n)
+    : n_(n), k_(0), c_(0) {
+    Detect(n, &k_, &c_);
+}
+bool SpecialModulus::Detect(const BigInt<uint128_t>& n, uint64_t* k,
+                            int64_t* c) {
+    // folding is only worth it if c is much shorter than n
+    constexpr uint64_t MIN_BITS = 128, MAX_C_BITS = 62;
+    constexpr uint64_t C_MASK = (uint64_t(1) << MAX_C_BITS) - 1;
+    if (n.Sign()) return false;
+    uint64_t len = n.BitLen();
+    if (len <= MIN_BITS) return false;
+    auto v = reinterpret_cast<const uint64_t*>(n.val_);
+    // the digit of the leading bit, at least the third
+    uint64_t top = (len - 1) >> 6, bit = uint64_t(1) << ((len - 1) & 63);
+    // 2^(len-1) + d: zeros between d and the leading bit
+    if (v[top] == bit && !(v[0] >> MAX_C_BITS)) {
+        uint64_t i = top - 1;
+        while (i && !v[i]) --i;
+        if (!i) {
+            if (k) *k = len - 1;
+            if (c) *c = -int64_t(v[0]);
+            return true;
+        }
+        return false;
+    }
+    // 2^len - d with 0 < d < 2^62: ones from bit 62 up, the rest not zero
+    if (v[top] == (bit | (bit - 1)) && v[0] >> MAX_C_BITS == 3 &&
+        v[0] & C_MASK) {
+        uint64_t i = top - 1;
+        while (i && !~v[i]) --i;
+        if (!i) {
+            if (k) *k = len;
+            if (c) *c = int64_t((C_MASK + 1) - (v[0] & C_MASK));
+            return true;
+        }
+    }
+    return false;
+}
+BigInt<uint128_t>& SpecialModulus::Reduce(BigInt<uint128_t>& x) const {
+    if (!k_) {
+        x %= n_;
+        if (x.Sign()) x += n_;
+        return x;
+    }
+    // x = hi * 2^k + lo = hi * c + lo (mod n), reduce |x| and flip at last
+    bool sign = x.Sign();
+    if (sign) x.ToOpposite();
+    uint64_t c = c_ < 0 ? -uint64_t(c_) : uint64_t(c_);
+    BigInt<uint128_t> hi;
+    while (x.BitLen() > k_) {
+        hi = x >> k_;
+        x.CutBit(k_);
+        if (c != 1) hi *= c;
+        if (c_ >= 0) {
+            x += hi;
+        } else {
+            x -= hi;
+            if (x.Sign()) {
+                x.ToOpposite();
+                sign = !sign;
+            }
+        }
+    }
+    if (x >= n_) x -= n_;
+    if (sign && x) {
+        x -= n_;
+        x.ToOpposite();
+    }
+    return x;
+}
+BigInt<uint128_t> SpecialModulus::MulMod(BigInt<uint128_t> a,
+                                         const BigInt<uint128_t>& b) const {
+    a *= b;
+    return Reduce(a);
+}
 BigInt<uint128_t> GcdBin(BigInt<uint128_t> a, BigInt<uint128_t> b) {
     a.ToAbsolute();
     b.ToAbsolute();
@@ -307,6 +436,11 @@ BigInt<uint128_t> ExtGcdBin(BigInt<uint128_t> a, BigInt<uint128_t> b,
     }
     // p*a0+q*b0=a, r*a0+s*b0=b
     BigInt<uint128_t> p(1), q(0), r(0), s(1);
+    // the coefficients stay below 2*max(a0, b0), take their room up front
+    for (auto c : {&p, &q, &r, &s}) {
+        c->SetLen(std::max(a.len_, b.len_) + 2, true);
+        c->ShrinkLen();
+    }
     size_t t0 = std::min(a.TrailingZero(), b.TrailingZero());
     size_t t1, t2;
     bool swapped = false;
@@ -410,4 +544,87 @@ BigInt<uint128_t> ExtGcdBin(BigInt<uint128_t> a, BigInt<uint128_t> b,
         }
     }
 }
+static BigInt<uint128_t> SqrtRemCore(const BigInt<uint128_t>& a, uint64_t n,
+                                     BigInt<uint128_t>* r) {
+    // Zimmermann's Karatsuba square root, a has 2n-1 or 2n bits
+    if (n < 64) {
+        uint128_t x = *a.Data();
+        uint64_t s = std::sqrt(double(x));
+        // double is only good to about 52 bits
+        if (s) s = (s + uint64_t(x / s)) >> 1;
+        while (uint128_t(s) * s > x) --s;
+        while (uint128_t(s + 1) * (s + 1) <= x) ++s;
+        *r = BigInt<uint128_t>(uint64_t(x - uint128_t(s) * s));
+        return BigInt<uint128_t>(s);
+    }
+    uint64_t l = n >> 1, h = n - l;
+    BigInt<uint128_t> s, q, u;
+    s = SqrtRemCore(a >> (l << 1), h, r);
+    q = (*r << l) + (a >> l).CutBit(l);
+    s <<= 1;
+    q.DivEq(s, &u);
+    s <<= l - 1;
+    s += q;
+    u <<= l;
+    u += BigInt<uint128_t>(a).CutBit(l);
+    q.SquareEq();
+    u -= q;
+    if (u.Sign()) {
+        u += s;
+        u += s;
+        --u;
+        --s;
+    }
+    *r = std::move(u);
+    return s;
+}
+BigInt<uint128_t> SqrtRem(const BigInt<uint128_t>& a, BigInt<uint128_t>* rem) {
+    if (a.Sign() || !a) {
+        if (rem) *rem = a;
+        return BigInt<uint128_t>(0);
+    }
+    BigInt<uint128_t> r;
+    auto s = SqrtRemCore(a, (a.BitLen() + 1) >> 1, &r);
+    if (rem) *rem = std::move(r);
+    return s;
+}
+BigInt<uint128_t> Sqrt(const BigInt<uint128_t>& a) {
+    return SqrtRem(a, nullptr);
+}
+BigInt<uint128_t> Root(const BigInt<uint128_t>& a, uint64_t k) {
+    if (k <= 1) return a;
+    if (a.Sign()) {
+        if (k & 1) return -Root(-a, k);
+        return BigInt<uint128_t>(0);
+    }
+    if (k == 2) return Sqrt(a);
+    uint64_t len = a.BitLen();
+    if (!len) return BigInt<uint128_t>(0);
+    if (len <= k) return BigInt<uint128_t>(1);
+    uint64_t rbits = (len + k - 1) / k;
+    BigInt<uint128_t> x, y;
+    if (rbits <= 32) {
+        // floating-point seed from the top bits, rounded up
+        double lg =
+            len > 62
+                ? std::log2(double(int64_t(a >> (len - 62)))) + double(len - 62)
+                : std::log2(double(int64_t(a)));
+        x = BigInt<uint128_t>(uint64_t(std::exp2(lg / k) * (1 + 1e-12)) + 1);
+    } else {
+        // root of the upper half precision, rounded up
+        uint64_t m = rbits >> 1;
+        x = Root(a >> (k * m), k);
+        ++x;
+        x <<= m;
+    }
+    // Newton iteration from above, stops when it no longer decreases
+    while (true) {
+        y = a / Power(x, k - 1);
+        y += x * (k - 1);
+        y /= int64_t(k);
+        if (!(y < x)) break;
+        x = std::move(y);
+    }
+    return x;
+}
 }  // namespace calc
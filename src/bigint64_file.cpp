@@ -0,0 +1,298 @@
+#include <fcntl.h>
+#include <new>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "bigint64.hpp"
+namespace calc {
+BigInt<uint128_t> LoadText(const char* path, int base, bool* ok) {
+    BigInt<uint128_t> result;
+    if (ok) *ok = false;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return result;
+    struct stat st;
+    if (fstat(fd, &st) || st.st_size <= 0) {
+        close(fd);
+        return result;
+    }
+    size_t size = st.st_size;
+    void* map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return result;
+    madvise(map, size, MADV_SEQUENTIAL);
+    auto it = static_cast<const char*>(map), end = it + size;
+    while (it != end && std::isspace(static_cast<unsigned char>(*it))) ++it;
+    bool sign = it != end && *it == '-';
+    if (it != end && (*it == '-' || *it == '+')) ++it;
+    // base prefix as in the string constructor
+    if (it != end && *it == '0') {
+        char c = it + 1 != end ? *(it + 1) : '\0';
+        if ((base == 0 || base == 2) && (c == 'B' || c == 'b')) {
+            base = 2;
+            it += 2;
+        } else if ((base == 0 || base == 16) && (c == 'X' || c == 'x')) {
+            base = 16;
+            it += 2;
+        } else if (base == 0) {
+            base = 8;
+        }
+    }
+    if (base < 2 || base > 36) base = 10;
+    // digits only from here, FromChars would take a second sign
+    if (it != end && *it != '-' && result.FromChars(it, end, base)) {
+        if (sign) result.ToOpposite();
+        if (ok) *ok = true;
+    }
+    munmap(map, size);
+    return result;
+}
+bool SaveText(const char* path, const BigInt<uint128_t>& value, int base) {
+    if (base < 2 || base > 36) base = 10;
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+    // digits go straight into the page cache, cut to size afterwards
+    size_t size = value.ToCharsSize(base) + 1;
+    void* map = MAP_FAILED;
+    if (!ftruncate(fd, off_t(size)))
+        map = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        close(fd);
+        return false;
+    }
+    madvise(map, size, MADV_SEQUENTIAL);
+    auto first = static_cast<char*>(map);
+    auto res = value.ToChars(first, first + size - 1, base);
+    bool ok = res.ec == std::errc();
+    if (ok) *(res.ptr++) = '\n';
+    munmap(map, size);
+    ok = ok && !ftruncate(fd, res.ptr - first);
+    return !close(fd) && ok;
+}
+// native binary format, all fields little-endian
+static constexpr char BINARY_MAGIC[8] = {'C', 'A', 'L', 'C',
+                                         'B', 'I', '6', '4'};
+static constexpr uint32_t BINARY_VERSION = 1;
+struct BinaryHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t flags;  // bit 0: sign
+    uint64_t length;  // limbs, a zero limb follows
+    uint64_t checksum;
+    uint64_t reserved[4];
+};
+static_assert(sizeof(BinaryHeader) == 64, "limbs must stay aligned");
+// Fletcher-like sum over the uint64 digits, one pass at memory speed
+static uint64_t LimbChecksum(const uint128_t* val, uint64_t len) {
+    auto it = reinterpret_cast<const uint64_t*>(val);
+    auto end = it + (len << 1);
+    uint64_t a = len, b = 0;
+    for (; it != end; ++it) {
+        a += *it;
+        b += a;
+    }
+    return a ^ (b * 0x9e3779b97f4a7c15);
+}
+// header and limbs as found in [map, map + size), nullptr if malformed
+static const BinaryHeader* CheckBinary(const void* map, size_t size,
+                                       bool verify) {
+    auto head = static_cast<const BinaryHeader*>(map);
+    if (size < sizeof(BinaryHeader) ||
+        std::memcmp(head->magic, BINARY_MAGIC, 8) ||
+        head->version != BINARY_VERSION || head->length < 2 ||
+        head->length >= (size - sizeof(BinaryHeader)) / sizeof(uint128_t))
+        return nullptr;
+    auto val = reinterpret_cast<const uint128_t*>(head + 1);
+    if (val[head->length] ||
+        bool(head->flags & 1) != bool(val[head->length - 1] >> 127))
+        return nullptr;
+    if (verify && LimbChecksum(val, head->length) != head->checksum)
+        return nullptr;
+    return head;
+}
+static bool WriteAll(int fd, const void* src, size_t n) {
+    auto p = static_cast<const char*>(src);
+    while (n) {
+        auto r = write(fd, p, n);
+        if (r <= 0) return false;
+        p += r;
+        n -= r;
+    }
+    return true;
+}
+bool SaveBinary(const char* path, const BigInt<uint128_t>& value) {
+    BinaryHeader head{};
+    std::memcpy(head.magic, BINARY_MAGIC, 8);
+    head.version = BINARY_VERSION;
+    head.flags = value.Sign();
+    head.length = value.Length();
+    head.checksum = LimbChecksum(value.Data(), head.length);
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+    // the zero limb past the end is part of every BigInt
+    bool ok = WriteAll(fd, &head, sizeof(head)) &&
+              WriteAll(fd, value.Data(), (head.length + 1) * sizeof(uint128_t));
+    return !close(fd) && ok;
+}
+BigInt<uint128_t> LoadBinary(const char* path, bool* ok) {
+    BigInt<uint128_t> result;
+    if (ok) *ok = false;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return result;
+    BinaryHeader head;
+    struct stat st;
+    if (fstat(fd, &st) || pread(fd, &head, sizeof(head), 0) != sizeof(head) ||
+        std::memcmp(head.magic, BINARY_MAGIC, 8) ||
+        head.version != BINARY_VERSION || head.length < 2 ||
+        head.length >= (st.st_size - sizeof(head)) / sizeof(uint128_t)) {
+        close(fd);
+        return result;
+    }
+    // read straight into the limbs, no intermediate buffer
+    result.SetLenUninit(head.length);
+    auto dest = reinterpret_cast<char*>(result.val_);
+    size_t n = head.length * sizeof(uint128_t);
+    off_t pos = sizeof(head);
+    while (n) {
+        auto r = pread(fd, dest, n, pos);
+        if (r <= 0) break;
+        dest += r;
+        pos += r;
+        n -= r;
+    }
+    close(fd);
+    if (n || bool(head.flags & 1) != result.Sign() ||
+        LimbChecksum(result.val_, result.len_) != head.checksum) {
+        result.SetLen(0, false);
+        return result;
+    }
+    if (ok) *ok = true;
+    return result;
+}
+BigInt<uint128_t>::BigInt(uint128_t* val, uint64_t len)
+    : val_(val), len_(len), cap_(len + 1), end_(val + len), res_(nullptr) {}
+// backs every default BigIntView, never written
+static uint128_t VIEW_ZERO[3] = {};
+void BigIntView::Point(const uint128_t* val, uint64_t len) {
+    new (&value_) BigInt<uint128_t>(const_cast<uint128_t*>(val), len);
+}
+BigIntView::BigIntView() { Point(VIEW_ZERO, 2); }
+BigIntView::BigIntView(const uint128_t* val, uint64_t len) { Point(val, len); }
+BigIntView::BigIntView(const BigIntView& rhs) { *this = rhs; }
+BigIntView& BigIntView::operator=(const BigIntView& rhs) {
+    if (rhs.value_.val_ == rhs.short_) {
+        std::copy(rhs.short_, rhs.short_ + 3, short_);
+        Point(short_, 2);
+    } else {
+        Point(rhs.value_.val_, rhs.value_.len_);
+    }
+    return *this;
+}
+BigIntView BigIntView::High(const BigInt<uint128_t>& x, uint64_t pos) {
+    BigIntView view;
+    if (pos + 2 <= x.len_) {
+        // the zero limb of x ends the view too
+        view.Point(x.val_ + pos, x.len_ - pos);
+    } else {
+        uint128_t ext = x.Sign() ? -1 : 0;
+        view.short_[0] = pos < x.len_ ? x.val_[pos] : ext;
+        view.short_[1] = ext;
+        view.short_[2] = 0;
+        view.Point(view.short_, 2);
+    }
+    return view;
+}
+MappedBigInt::MappedBigInt(const char* path, bool verify)
+    : map_(nullptr), size_(0), view_() {
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd >= 0 && !fstat(fd, &st) && st.st_size > 0) {
+        // private writable pages: the zero limb past the end may be
+        // scribbled on like any BigInt's, but never reaches the file
+        size_ = st.st_size;
+        map_ = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd,
+                    0);
+        if (map_ == MAP_FAILED) map_ = nullptr;
+    }
+    if (fd >= 0) close(fd);
+    auto head = map_ ? CheckBinary(map_, size_, verify) : nullptr;
+    if (head) {
+        view_ = BigIntView(reinterpret_cast<const uint128_t*>(head + 1),
+                           head->length);
+    } else if (map_) {
+        munmap(map_, size_);
+        map_ = nullptr;
+    }
+}
+MappedBigInt::~MappedBigInt() {
+    if (map_) munmap(map_, size_);
+}
+static constexpr char BATCH_MAGIC[8] = {'C', 'A', 'L', 'C',
+                                        'B', 'A', '6', '4'};
+static constexpr uint32_t BATCH_VERSION = 1;
+struct BatchHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t count;
+    uint64_t limbs;  // total, with the zero limbs
+};
+// the offsets of n values in limbs, padded to the limb alignment
+static size_t BatchOffsetBytes(uint64_t n) {
+    return ((n + 1) * sizeof(uint64_t) + 15) & ~size_t(15);
+}
+std::vector<uint8_t> SerializeBatch(const BigInt<uint128_t>* values,
+                                    size_t n) {
+    BatchHeader head{};
+    std::memcpy(head.magic, BATCH_MAGIC, 8);
+    head.version = BATCH_VERSION;
+    head.count = n;
+    std::vector<uint64_t> offset(n + 1);
+    for (size_t i = 0; i < n; ++i)
+        offset[i + 1] = offset[i] + values[i].Length() + 1;
+    head.limbs = offset[n];
+    // appended into reserved space, each byte written once
+    std::vector<uint8_t> buf;
+    size_t off_bytes = BatchOffsetBytes(n);
+    buf.reserve(sizeof(head) + off_bytes + head.limbs * sizeof(uint128_t));
+    auto append = [&buf](const void* src, size_t bytes) {
+        auto p = static_cast<const uint8_t*>(src);
+        buf.insert(buf.end(), p, p + bytes);
+    };
+    append(&head, sizeof(head));
+    append(offset.data(), (n + 1) * sizeof(uint64_t));
+    buf.resize(sizeof(head) + off_bytes);
+    for (size_t i = 0; i < n; ++i)
+        append(values[i].Data(), (values[i].Length() + 1) * sizeof(uint128_t));
+    return buf;
+}
+std::vector<BigIntView> DeserializeBatch(const uint8_t* data, size_t size,
+                                         bool* ok) {
+    std::vector<BigIntView> views;
+    if (ok) *ok = false;
+    auto head = reinterpret_cast<const BatchHeader*>(data);
+    if (reinterpret_cast<uintptr_t>(data) & 15 || size < sizeof(BatchHeader) ||
+        std::memcmp(head->magic, BATCH_MAGIC, 8) ||
+        head->version != BATCH_VERSION ||
+        head->count >= (size - sizeof(BatchHeader)) / sizeof(uint64_t))
+        return views;
+    size_t off_bytes = BatchOffsetBytes(head->count);
+    size_t room = size - sizeof(BatchHeader);
+    if (room < off_bytes ||
+        head->limbs > (room - off_bytes) / sizeof(uint128_t))
+        return views;
+    auto offset = reinterpret_cast<const uint64_t*>(head + 1);
+    auto val = reinterpret_cast<const uint128_t*>(
+        reinterpret_cast<const uint8_t*>(offset) + off_bytes);
+    if (offset[0] || offset[head->count] != head->limbs) return views;
+    for (uint64_t i = 0; i < head->count; ++i)
+        if (offset[i + 1] < offset[i] + 3 || offset[i + 1] > head->limbs ||
+            val[offset[i + 1] - 1])
+            return views;
+    views.reserve(head->count);
+    for (uint64_t i = 0; i < head->count; ++i)
+        views.emplace_back(val + offset[i], offset[i + 1] - offset[i] - 1);
+    if (ok) *ok = true;
+    return views;
+}
+}  // namespace calc
@@ -1,16 +1,198 @@
+#include <immintrin.h>
+
+#include <algorithm>
 #include <iomanip>
 
 #include "bigint64.hpp"
 namespace calc {
+static constexpr uint8_t DIGIT_DECODE[75] = {
+    0,  1,  2,  3,  4,  5,  6,  7,  8,  9,  64, 64, 64, 64, 64,
+    64, 64, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22,
+    23, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 64, 64,
+    64, 64, 64, 64, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20,
+    21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35};
+struct DigitsTable {
+    uint8_t u64[37], u127[37];
+};
+// most digits of each base that always fit in 64 and in 127 bits, the
+// former with room for base^digits
+static constexpr DigitsTable DIGITS_FIT = [] {
+    DigitsTable table{};
+    for (int base = 2; base <= 36; ++base) {
+        for (uint128_t p = 1; p <= UINT64_MAX / base; p *= base)
+            ++table.u64[base];
+        for (uint128_t p = 1; p <= (uint128_t(1) << 127) / base; p *= base)
+            ++table.u127[base];
+    }
+    return table;
+}();
+static constexpr char DIGIT_PAIRS[201] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536"
+    "37383940414243444546474849505152535455565758596061626364656667686970717273"
+    "7475767778798081828384858687888990919293949596979899";
+// digit chars of the bases up to 36
+static const char* Charset(bool uppercase) {
+    return uppercase ? "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+                     : "0123456789abcdefghijklmnopqrstuvwxyz";
+}
+// table lookup only, std::isalnum goes through the locale
+static bool IsDigit(char c, int base) {
+    auto i = static_cast<unsigned char>(c - '0');
+    return i < sizeof(DIGIT_DECODE) && DIGIT_DECODE[i] < base;
+}
+// chars or values of one parallel piece of the batch text functions
+static constexpr uint64_t BATCH_CHARS = uint64_t(1) << 16;
+static constexpr uint64_t BATCH_VALUES = uint64_t(1) << 12;
+// ParallelFor of the shared pool, which is only started once n exceeds
+// grain; fn runs inline below that
+static void SharedParallelFor(
+    uint64_t n, uint64_t grain,
+    const std::function<void(uint64_t, uint64_t)>& fn) {
+    if (n <= grain) return fn(0, n);
+    WorkerPool::Shared().ParallelFor(n, grain, fn);
+}
+// SIMD kernels of the power-of-two bases, chosen at run time
+static bool HasSSSE3() {
+    static const bool has =
+        (__builtin_cpu_init(), __builtin_cpu_supports("ssse3"));
+    return has;
+}
+static bool HasAVX2() {
+    static const bool has =
+        (__builtin_cpu_init(), __builtin_cpu_supports("avx2"));
+    return has;
+}
+// 16 hex digits per word, from src[m - 1] down to src[0]
+__attribute__((target("ssse3"))) static void EncodeHexSSSE3(
+    char* dest, const uint64_t* src, uint64_t m, const char* charset) {
+    const __m128i lut =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(charset));
+    const __m128i low = _mm_set1_epi8(0xf);
+    for (uint64_t j = m; j--; dest += 16) {
+        __m128i x = _mm_cvtsi64_si128(int64_t(__builtin_bswap64(src[j])));
+        __m128i nibbles = _mm_unpacklo_epi8(
+            _mm_and_si128(_mm_srli_epi16(x, 4), low), _mm_and_si128(x, low));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dest),
+                         _mm_shuffle_epi8(lut, nibbles));
+    }
+}
+static void EncodeHex(char* dest, const uint64_t* src, uint64_t m,
+                      const char* charset) {
+    if (HasSSSE3()) return EncodeHexSSSE3(dest, src, m, charset);
+    for (uint64_t j = m; j--;)
+        for (int i = 60; i >= 0; i -= 4) *(dest++) = charset[src[j] >> i & 15];
+}
+// 64 binary digits per word, from src[m - 1] down to src[0]
+__attribute__((target("avx2"))) static void EncodeBinAVX2(char* dest,
+                                                          const uint64_t* src,
+                                                          uint64_t m) {
+    // each of the 4 bytes to 8 lanes, the most significant first
+    const __m256i spread = _mm256_setr_epi8(
+        3, 3, 3, 3, 3, 3, 3, 3, 2, 2, 2, 2, 2, 2, 2, 2, 1, 1, 1, 1, 1, 1, 1, 1,
+        0, 0, 0, 0, 0, 0, 0, 0);
+    const __m256i mask = _mm256_set1_epi64x(0x0102040810204080);
+    const __m256i zero = _mm256_set1_epi8('0');
+    for (uint64_t j = m; j--;) {
+        for (int h = 32; h >= 0; h -= 32, dest += 32) {
+            __m256i x = _mm256_shuffle_epi8(
+                _mm256_set1_epi32(int(src[j] >> h)), spread);
+            x = _mm256_cmpeq_epi8(_mm256_and_si256(x, mask), mask);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dest),
+                                _mm256_sub_epi8(zero, x));
+        }
+    }
+}
+static void EncodeBin(char* dest, const uint64_t* src, uint64_t m) {
+    if (HasAVX2()) return EncodeBinAVX2(dest, src, m);
+    for (uint64_t j = m; j--;)
+        for (int i = 63; i >= 0; --i) *(dest++) = char('0' + (src[j] >> i & 1));
+}
+// 8 octal digits of x < 2^24 as chars, the most significant first in memory
+static uint64_t SpreadOct(uint64_t x) {
+    // the 3-bit fields to bytes, halving the groups at each step
+    x = (x & 0xfff) | (x & 0xfff000) << 20;
+    x = (x & 0x0000003f0000003f) | (x & 0x00000fc000000fc0) << 10;
+    x = (x & 0x0007000700070007) | (x & 0x0038003800380038) << 5;
+    return __builtin_bswap64(x) + 0x3030303030303030;
+}
+// 64 octal digits per 3 words, from src[3m - 1] down to src[0]
+static void EncodeOct(char* dest, const uint64_t* src, uint64_t m) {
+    constexpr uint64_t mask = 0xffffff;
+    uint64_t c[8];
+    for (uint64_t j = m; j--;) {
+        auto s = src + 3 * j;
+        c[0] = s[0] & mask;
+        c[1] = s[0] >> 24 & mask;
+        c[2] = (s[0] >> 48 | s[1] << 16) & mask;
+        c[3] = s[1] >> 8 & mask;
+        c[4] = s[1] >> 32 & mask;
+        c[5] = (s[1] >> 56 | s[2] << 8) & mask;
+        c[6] = s[2] >> 16 & mask;
+        c[7] = s[2] >> 40;
+        for (int k = 8; k--; dest += 8) {
+            uint64_t chars = SpreadOct(c[k]);
+            std::memcpy(dest, &chars, 8);
+        }
+    }
+}
+// word of 16 valid hex digits, the most significant first
+__attribute__((target("ssse3"))) static uint64_t DecodeHexSSSE3(
+    const char* src) {
+    __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+    // letters have 0x40 set, their low nibble is 9 less than the value
+    __m128i f = _mm_srli_epi16(_mm_and_si128(c, _mm_set1_epi8(0x40)), 6);
+    __m128i v = _mm_add_epi8(_mm_and_si128(c, _mm_set1_epi8(0xf)),
+                             _mm_add_epi8(f, _mm_slli_epi16(f, 3)));
+    v = _mm_maddubs_epi16(v, _mm_set1_epi16(0x0110));
+    v = _mm_packus_epi16(v, v);
+    return __builtin_bswap64(uint64_t(_mm_cvtsi128_si64(v)));
+}
+// word of 64 binary digits, the most significant first
+__attribute__((target("ssse3"))) static uint64_t DecodeBinSSSE3(
+    const char* src) {
+    const __m128i rev =
+        _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+    uint64_t result = 0;
+    for (int k = 0; k < 64; k += 16) {
+        __m128i c = _mm_shuffle_epi8(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + k)), rev);
+        result = result << 16 |
+                 uint32_t(_mm_movemask_epi8(_mm_slli_epi64(c, 7)));
+    }
+    return result;
+}
+// 8 valid octal digits to 24 bits, the most significant first
+static uint64_t PackOct(const char* src) {
+    uint64_t x;
+    std::memcpy(&x, src, 8);
+    x = __builtin_bswap64(x) - 0x3030303030303030;
+    x = (x & 0x0007000700070007) | (x & 0x0700070007000700) >> 5;
+    x = (x & 0x0000003f0000003f) | (x & 0x003f0000003f0000) >> 10;
+    return (x & 0xfff) | (x & 0xfff00000000) >> 20;
+}
+// 3 words of 64 octal digits, the most significant first
+static void DecodeOct(uint64_t* dest, const char* src) {
+    uint64_t c[8];
+    for (int k = 0; k < 8; ++k) c[k] = PackOct(src + 8 * (7 - k));
+    dest[0] = c[0] | c[1] << 24 | c[2] << 48;
+    dest[1] = c[2] >> 16 | c[3] << 8 | c[4] << 32 | c[5] << 56;
+    dest[2] = c[5] >> 8 | c[6] << 16 | c[7] << 40;
+}
 void BigInt<uint128_t>::Print(int base, int showbase, bool uppercase,
                               std::FILE* f) const {
+    Print([f](const char* str, size_t n) { std::fwrite(str, 1, n, f); }, base,
+          showbase, uppercase);
+}
+void BigInt<uint128_t>::Print(
+    const std::function<void(const char*, size_t)>& sink, int base,
+    int showbase, bool uppercase) const {
     if (Sign()) {
         auto tmp_obj = -*this;
-        std::fputc('-', f);
-        tmp_obj.Print(base, showbase, uppercase, f);
+        sink("-", 1);
+        tmp_obj.Print(sink, base, showbase, uppercase);
         return;
     } else if (!*this) {
-        std::fprintf(f, "0");
+        sink("0", 1);
         return;
     }
     if (base < 2 || base > 36) base = 16;
@@ -18,101 +200,60 @@ void BigInt<uint128_t>::Print(int base, int showbase, bool uppercase,
     if (showbase == 1) {
         switch (base) {
             case 2:
-                if (uppercase)
-                    std::fwrite("0B", 1, 2, f);
-                else
-                    std::fwrite("0b", 1, 2, f);
+                sink(uppercase ? "0B" : "0b", 2);
                 break;
             case 8:
-                std::fputc('0', f);
+                sink("0", 1);
                 break;
             case 16:
-                if (uppercase)
-                    std::fwrite("0X", 1, 2, f);
-                else
-                    std::fwrite("0x", 1, 2, f);
+                sink(uppercase ? "0X" : "0x", 2);
                 break;
             default:
                 suffix_base = true;
                 break;
         }
     }
-    if (base == 16) {
-        auto it = end_ - 1;
-        if (uppercase) {
-            if (!*it) --it;
-            if (*(reinterpret_cast<uint64_t*>(it) + 1)) {
-                std::fprintf(f, "%llX%016llX",
-                             *(reinterpret_cast<uint64_t*>(it) + 1),
-                             *reinterpret_cast<uint64_t*>(it));
-            } else {
-                std::fprintf(f, "%llX", *reinterpret_cast<uint64_t*>(it));
-            }
-            while (it != val_) {
-                --it;
-                std::fprintf(f, "%016llX%016llX",
-                             *(reinterpret_cast<uint64_t*>(it) + 1),
-                             *reinterpret_cast<uint64_t*>(it));
-            }
-        } else {
-            if (!*it) --it;
-            if (*(reinterpret_cast<uint64_t*>(it) + 1)) {
-                std::fprintf(f, "%llx%016llx",
-                             *(reinterpret_cast<uint64_t*>(it) + 1),
-                             *reinterpret_cast<uint64_t*>(it));
-            } else {
-                std::fprintf(f, "%llx", *reinterpret_cast<uint64_t*>(it));
-            }
-            while (it != val_) {
-                --it;
-                std::fprintf(f, "%016llx%016llx",
-                             *(reinterpret_cast<uint64_t*>(it) + 1),
-                             *reinterpret_cast<uint64_t*>(it));
-            }
+    auto charset = Charset(uppercase);
+    uint64_t bits = 0, n;
+    while ((1 << bits) < base) ++bits;
+    if ((1 << bits) == base) {
+        n = (BitLen() + bits - 1) / bits;
+        std::vector<char> buf(std::min(n, STREAM_BLOCK));
+        for (uint64_t len; n; n -= len) {
+            len = std::min(n, STREAM_BLOCK);
+            WriteDigitsPow2(*this, buf.data(), n - len, len, bits, charset);
+            sink(buf.data(), len);
         }
     } else {
-        std::string&& str = ToString(base, 0, uppercase);
-        std::fwrite(str.data(), 1, str.length(), f);
+        n = uint64_t(double(BitLen()) / std::log2(double(base))) + 2;
+        std::vector<char> buf(std::min(n, STREAM_BLOCK));
+        auto tmp_obj = *this;
+        bool leading = true;
+        StreamDigits(tmp_obj, n, base, charset,
+                     (len_ << 1) > CONV_WRITE_DC_LIMIT
+                         ? ConvPowers(base, n)
+                         : std::vector<BigInt>(),
+                     buf.data(), [&](const char* str, size_t len) {
+                         // n is an upper bound, skip the leading zeros
+                         if (leading) {
+                             auto end = str + len;
+                             while (str != end && *str == '0') ++str;
+                             len = end - str;
+                             leading = !len;
+                         }
+                         if (len) sink(str, len);
+                     });
+    }
+    if (suffix_base && base != 10) {
+        char buf[8];
+        sink(buf, std::sprintf(buf, "_%d", base));
     }
-    if (suffix_base && base != 10) std::fprintf(f, "_%d", base);
 }
 std::ostream& operator<<(std::ostream& out, const BigInt<uint128_t>& rhs) {
-    // std::fprintf(stdout, "high: %llx, %llx\n",
-    // *(reinterpret_cast<uint64_t*>(rhs.end_) - 1),
-    // *(reinterpret_cast<uint64_t*>(rhs.end_) - 2));
-    if (rhs.Sign()) {
-        out.put('-');
-        return out << -rhs;
-    } else if (!rhs) {
-        return out.put('0');
-    }
-    bool showbase = out.flags() & out.showbase;
-    if (out.flags() & out.hex) {
-        auto it = rhs.end_ - 1;
-        if (!*it) --it;
-        if (*(reinterpret_cast<uint64_t*>(it) + 1)) {
-            out << *(reinterpret_cast<uint64_t*>(it) + 1);
-            out.unsetf(out.showbase);
-            out << std::setfill('0') << std::setw(16)
-                << *reinterpret_cast<uint64_t*>(it);
-        } else {
-            out << *reinterpret_cast<uint64_t*>(it);
-            out.unsetf(out.showbase);
-        }
-        while (it != rhs.val_) {
-            --it;
-            out << std::setfill('0') << std::setw(16)
-                << *(reinterpret_cast<uint64_t*>(it) + 1);
-            out << std::setfill('0') << std::setw(16)
-                << *reinterpret_cast<uint64_t*>(it);
-        }
-    } else {
-        std::string&& str =
-            rhs.ToString((out.flags() & out.oct) ? 8 : 10, showbase ? 1 : 0,
-                         out.flags() & out.uppercase);
-        out.write(str.data(), str.length());
-    }
-    if (showbase) out.setf(out.showbase);
+    auto flags = out.flags();
+    int base = (flags & out.hex) ? 16 : (flags & out.oct) ? 8 : 10;
+    rhs.Print([&out](const char* str, size_t n) { out.write(str, n); }, base,
+              (flags & out.showbase) ? 1 : 0, flags & out.uppercase);
     return out;
 }
 std::string BigInt<uint128_t>::ToString(int base, int showbase,
@@ -125,7 +266,7 @@ std::string BigInt<uint128_t>::ToString(int base, int showbase,
     }
     if (base < 2 || base > 36) base = 16;
     bool suffix_base = showbase == 2;
-    std::string result = "", rev_str = "";
+    std::string result = "";
     if (showbase == 1) {
         switch (base) {
             case 2:
@@ -148,157 +289,442 @@ std::string BigInt<uint128_t>::ToString(int base, int showbase,
                 break;
         }
     }
-    char charset[37] = "0123456789abcdefghijklmnopqrstuvwxyz";
-    if (uppercase) std::strncpy(charset + 10, "ABCDEFGHIJKLMNOPQRSTUVWXYZ", 26);
+    auto charset = Charset(uppercase);
     char buf[129];
-    if (base == 16) {
-        auto it = end_ - 1;
-        if (uppercase) {
-            if (!*it) --it;
-            if (*(reinterpret_cast<uint64_t*>(it) + 1)) {
-                std::sprintf(buf, "%llX%016llX",
-                             *(reinterpret_cast<uint64_t*>(it) + 1),
-                             *reinterpret_cast<uint64_t*>(it));
-            } else {
-                std::sprintf(buf, "%llX", *reinterpret_cast<uint64_t*>(it));
-            }
-            result += buf;
-            while (it != val_) {
-                --it;
-                std::sprintf(buf, "%016llX%016llX",
-                             *(reinterpret_cast<uint64_t*>(it) + 1),
-                             *reinterpret_cast<uint64_t*>(it));
-                result.append(buf, 32);
+    uint64_t bits = 0, pos = result.length(), n;
+    while ((1 << bits) < base) ++bits;
+    if ((1 << bits) == base) {
+        n = (BitLen() + bits - 1) / bits;
+        result.resize(pos + n);
+        WriteDigitsPow2(*this, &result[pos], 0, n, bits, charset);
+    } else {
+        // an upper bound of the digits, leading zeros erased at last
+        n = uint64_t(double(BitLen()) / std::log2(double(base))) + 2;
+        result.resize(pos + n);
+        auto tmp_obj = *this;
+        WriteDigits(tmp_obj, &result[pos], n, base, charset,
+                    (len_ << 1) > CONV_WRITE_DC_LIMIT ? ConvPowers(base, n)
+                                                      : std::vector<BigInt>());
+        result.erase(pos, result.find_first_not_of('0', pos) - pos);
+    }
+    if (suffix_base && base != 10) {
+        std::sprintf(buf, "_%d", base);
+        result += buf;
+    }
+    return result;
+}
+uint64_t BigInt<uint128_t>::ChunkDigits(int base, int64_t* power) {
+    uint64_t chunk = 1;
+    int64_t p = base;
+    while (p <= INT64_MAX / base) {
+        p *= base;
+        ++chunk;
+    }
+    *power = p;
+    return chunk;
+}
+std::vector<BigInt<uint128_t>> BigInt<uint128_t>::ConvPowers(int base,
+                                                            uint64_t n) {
+    int64_t power;
+    uint64_t chunk = ChunkDigits(base, &power);
+    std::vector<BigInt> pow;
+    pow.emplace_back(uint64_t(power));
+    while ((chunk << pow.size()) < n) pow.push_back(Square(pow.back()));
+    return pow;
+}
+char* BigInt<uint128_t>::WriteChunks(uint64_t* digits, uint64_t m,
+                                    char* first, char* last, int base,
+                                    const char* charset) {
+    int64_t divbase;
+    uint64_t chunk = ChunkDigits(base, &divbase), d = divbase, r;
+    auto it = last;
+    while (m && !digits[m - 1]) --m;
+    while (m && uint64_t(it - first) >= chunk) {
+        r = 0;
+        for (uint64_t j = m; j--;)
+            asm("divq %2" : "+a"(digits[j]), "+d"(r) : "rm"(d) : "cc");
+        while (m && !digits[m - 1]) --m;
+        // a constant divisor and two digits a step for the common base
+        if (base == 10) {
+            uint64_t i = 0;
+            for (; i + 1 < chunk; i += 2, r /= 100) {
+                it -= 2;
+                std::memcpy(it, DIGIT_PAIRS + (r % 100) * 2, 2);
             }
-        } else {
-            if (!*it) --it;
-            if (*(reinterpret_cast<uint64_t*>(it) + 1)) {
-                std::sprintf(buf, "%llx%016llx",
-                             *(reinterpret_cast<uint64_t*>(it) + 1),
-                             *reinterpret_cast<uint64_t*>(it));
-            } else {
-                std::sprintf(buf, "%llx", *reinterpret_cast<uint64_t*>(it));
+            // the last digit of an odd chunk
+            if (i < chunk) *(--it) = char('0' + r);
+        } else
+            for (uint64_t i = 0; i < chunk; ++i, r /= base)
+                *(--it) = charset[r % base];
+    }
+    // the top, below base^(it - first) if the digits fit
+    for (r = m ? digits[0] : 0; r && it != first; r /= base)
+        *(--it) = charset[r % base];
+    return it;
+}
+void BigInt<uint128_t>::WriteDigits(BigInt& x, char* dest, uint64_t n,
+                                    int base, const char* charset,
+                                    const std::vector<BigInt>& pow) {
+    int64_t divbase;
+    uint64_t chunk = ChunkDigits(base, &divbase);
+    if ((x.len_ << 1) <= CONV_WRITE_DC_LIMIT) {
+        auto it = WriteChunks(reinterpret_cast<uint64_t*>(x.val_),
+                              x.len_ << 1, dest, dest + n, base, charset);
+        std::fill(dest, it, '0');
+        return;
+    }
+    // x = high * base^nl + low, the halves are independent
+    uint64_t k = 0;
+    while ((chunk << (k + 1)) < n) ++k;
+    uint64_t nl = chunk << k;
+    BigInt low;
+    x.DivEq(pow[k], &low);
+    auto high_part = [&] { WriteDigits(x, dest, n - nl, base, charset, pow); };
+    auto low_part = [&] {
+        WriteDigits(low, dest + n - nl, nl, base, charset, pow);
+    };
+    if ((low.len_ << 1) >= CONV_PARALLEL_LIMIT) {
+        WorkerPool::Shared().Fork(high_part, low_part);
+    } else {
+        high_part();
+        low_part();
+    }
+}
+void BigInt<uint128_t>::WriteDigitsPow2(const BigInt& x, char* dest,
+                                        uint64_t first, uint64_t n,
+                                        uint64_t bits, const char* charset) {
+    auto src = reinterpret_cast<const uint64_t*>(x.val_);
+    uint64_t mask = (uint64_t(1) << bits) - 1;
+    auto digit = [=](uint64_t i) {
+        uint64_t pos = (first + i) * bits, off = pos & 63;
+        auto it = src + (pos >> 6);
+        uint64_t v = *it >> off;
+        if (off + bits > 64) v |= *(it + 1) << (64 - off);
+        dest[n - 1 - i] = charset[v & mask];
+    };
+    SharedParallelFor(
+        n, CONV_PARALLEL_LIMIT << 4, [=](uint64_t begin, uint64_t end) {
+            uint64_t i = begin;
+            if (bits == 4 || bits == 1 || bits == 3) {
+                // whole words in the middle, blocks of 3 words for octal
+                uint64_t d = bits == 3 ? 64 : 64 / bits, m;
+                for (; i < end && (first + i) % d; ++i) digit(i);
+                if ((m = (end - i) / d)) {
+                    auto out = dest + n - i - m * d;
+                    auto block = (first + i) / d;
+                    if (bits == 4)
+                        EncodeHex(out, src + block, m, charset);
+                    else if (bits == 1)
+                        EncodeBin(out, src + block, m);
+                    else
+                        EncodeOct(out, src + 3 * block, m);
+                    i += m * d;
+                }
             }
-            result += buf;
-            while (it != val_) {
-                --it;
-                std::sprintf(buf, "%016llx%016llx",
-                             *(reinterpret_cast<uint64_t*>(it) + 1),
-                             *reinterpret_cast<uint64_t*>(it));
-                result.append(buf, 32);
+            for (; i < end; ++i) digit(i);
+        });
+}
+void BigInt<uint128_t>::ReadDigitsPow2(BigInt& result, const char* src,
+                                       uint64_t n, uint64_t bits) {
+    uint64_t words = (n * bits + 63) >> 6;
+    // one more limb for the sign
+    result.SetLenUninit(((words + 1) >> 1) + 1);
+    auto dest = reinterpret_cast<uint64_t*>(result.val_);
+    std::fill(dest, dest + (result.len_ << 1), 0);
+    if (bits == 4 || bits == 1) {
+        uint64_t d = 64 / bits, m = n / d;
+        SharedParallelFor(
+            m, CONV_PARALLEL_LIMIT, [=](uint64_t begin, uint64_t end) {
+                for (uint64_t w = begin; w < end; ++w) {
+                    auto it = src + n - d * (w + 1);
+                    if (bits == 4 && HasSSSE3()) {
+                        dest[w] = DecodeHexSSSE3(it);
+                    } else if (bits == 1 && HasSSSE3()) {
+                        dest[w] = DecodeBinSSSE3(it);
+                    } else {
+                        for (auto term = it + d; it != term; ++it)
+                            dest[w] = dest[w] << bits | DIGIT_DECODE[*it - '0'];
+                    }
+                }
+            });
+        // the most significant n % d digits
+        for (auto it = src, term = src + n - m * d; it != term; ++it)
+            dest[m] = dest[m] << bits | DIGIT_DECODE[*it - '0'];
+    } else {
+        // whole blocks of 64 digits in 3 words for octal
+        uint64_t m = bits == 3 ? n / 64 : 0;
+        SharedParallelFor(
+            m, CONV_PARALLEL_LIMIT, [=](uint64_t begin, uint64_t end) {
+                for (uint64_t w = begin; w < end; ++w)
+                    DecodeOct(dest + 3 * w, src + n - 64 * (w + 1));
+            });
+        for (uint64_t j = m * 64; j < n; ++j) {
+            uint64_t v = DIGIT_DECODE[src[n - 1 - j] - '0'], pos = j * bits,
+                     off = pos & 63;
+            dest[pos >> 6] |= v << off;
+            if (off + bits > 64) dest[(pos >> 6) + 1] |= v >> (64 - off);
+        }
+    }
+    result.ShrinkLen();
+}
+void BigInt<uint128_t>::StreamDigits(
+    BigInt& x, uint64_t n, int base, const char* charset,
+    const std::vector<BigInt>& pow, char* buf,
+    const std::function<void(const char*, size_t)>& sink) {
+    if (n <= STREAM_BLOCK) {
+        WriteDigits(x, buf, n, base, charset, pow);
+        sink(buf, n);
+        return;
+    }
+    int64_t power;
+    uint64_t chunk = ChunkDigits(base, &power), k = 0;
+    while ((chunk << (k + 1)) < n) ++k;
+    uint64_t nl = chunk << k;
+    BigInt low;
+    x.DivEq(pow[k], &low);
+    StreamDigits(x, n - nl, base, charset, pow, buf, sink);
+    x = BigInt();
+    StreamDigits(low, nl, base, charset, pow, buf, sink);
+}
+void BigInt<uint128_t>::ReadDigits(BigInt& result, const char* src,
+                                   uint64_t n, int base,
+                                   const std::vector<BigInt>& pow) {
+    int64_t power;
+    uint64_t chunk = ChunkDigits(base, &power);
+    if (n <= chunk * CONV_READ_DC_LIMIT) {
+        // a group is below 2^63, so the words never outnumber the groups;
+        // one more half limb for the sign
+        uint64_t groups = (n + chunk - 1) / chunk, m = 0;
+        result.SetLenUninit((groups >> 1) + 1);
+        auto dest = reinterpret_cast<uint64_t*>(result.val_);
+        auto end = src + n;
+        // the first group takes the remainder digits
+        uint64_t group = n ? (n - 1) % chunk + 1 : 0;
+        while (src != end) {
+            uint64_t buf = 0, bound = 1;
+            for (auto term = src + group; src != term; ++src) {
+                buf = buf * base + DIGIT_DECODE[*src - '0'];
+                bound *= base;
             }
+            if ((buf = MulAdd64(dest, m, bound, buf))) dest[m++] = buf;
+            group = chunk;
         }
-    } else if (base == 8) {
-        auto tmp_obj = *this;
-        uint128_t tmp, divbase = -1;
-        divbase = divbase << 2 >> 2;
-        do {
-            tmp = *val_ & divbase;
-            std::sprintf(buf, "%021llo%021llo", uint64_t(tmp),
-                         uint64_t(tmp >> 63));
-            rev_str.append(buf, 42);
-            tmp_obj >>= 126;
-        } while (tmp_obj);
-        for (auto it = rev_str.end() - 42; it >= rev_str.begin(); it -= 42) {
-            result.append(it, it + 42);
+        std::fill(dest + m, reinterpret_cast<uint64_t*>(result.end_), 0);
+        result.ShrinkLen();
+        return;
+    }
+    uint64_t k = 0;
+    while ((chunk << (k + 1)) < n) ++k;
+    uint64_t nl = chunk << k;
+    BigInt low;
+    auto high_part = [&] { ReadDigits(result, src, n - nl, base, pow); };
+    auto low_part = [&] { ReadDigits(low, src + n - nl, nl, base, pow); };
+    if (n >= chunk * CONV_PARALLEL_LIMIT) {
+        WorkerPool::Shared().Fork(high_part, low_part);
+    } else {
+        high_part();
+        low_part();
+    }
+    result *= pow[k];
+    result += low;
+}
+void BigInt<uint128_t>::AssignText(const char* src, uint64_t n, int base) {
+    if (n <= std::min<uint64_t>(DIGITS_FIT.u127[base],
+                                2 * DIGITS_FIT.u64[base])) {
+        // native, two independent uint64 halves joined in one limb
+        uint64_t nl = std::min<uint64_t>(n, DIGITS_FIT.u64[base]);
+        uint64_t high = 0, low = 0, bound = 1;
+        auto mid = src + n - nl, end = src + n;
+        for (; src != mid; ++src)
+            high = high * base + DIGIT_DECODE[*src - '0'];
+        for (; src != end; ++src) {
+            low = low * base + DIGIT_DECODE[*src - '0'];
+            bound *= base;
         }
-        if (showbase == 1)
-            result.erase(1, result.find_first_not_of('0', 1));
-        else
-            result.erase(0, result.find_first_not_of('0', 0));
-    } else if (base == 10) {
-        auto tmp_obj = *this;
-        int64_t tmp, divbase = 1000000000;
-        divbase *= divbase;  // 10^18
-        do {
-            tmp_obj.DivEq64(divbase, &tmp);
-            std::sprintf(buf + 19, "%018lld", tmp);
-            tmp_obj.DivEq64(divbase, &tmp);
-            std::sprintf(buf, "%018lld", tmp);
-            rev_str.append(buf, 18);
-            rev_str.append(buf + 19, 18);
-        } while (tmp_obj);
-        for (auto it = rev_str.end() - 36; it >= rev_str.begin(); it -= 36) {
-            result.append(it, it + 36);
+        SetLen(0, false);
+        *val_ = uint128_t(high) * bound + low;
+        return;
+    }
+    int64_t power;
+    uint64_t bits = 0, chunk = ChunkDigits(base, &power);
+    while ((1 << bits) < base) ++bits;
+    if ((1 << bits) == base)
+        ReadDigitsPow2(*this, src, n, bits);
+    else if (n <= chunk * CONV_READ_DC_LIMIT)
+        ReadDigits(*this, src, n, base, {});
+    else
+        ReadDigits(*this, src, n, base, ConvPowers(base, n));
+}
+uint64_t BigInt<uint128_t>::ToCharsSize(int base) const {
+    if (base < 2 || base > 36) return 0;
+    // bit length of |x| in place, from ~x and its carry when x < 0
+    bool sign = Sign();
+    auto w = reinterpret_cast<const uint64_t*>(val_);
+    uint64_t bits = 0, n = len_ << 1, len = 0,
+             fill = sign ? ~uint64_t(0) : 0;
+    while (n && w[n - 1] == fill) --n;
+    if (n) len = (n << 6) - __builtin_clzll(w[n - 1] ^ fill);
+    if (sign) {
+        // ~x + 1 carries into a new bit when ~x is all ones
+        uint64_t top = n ? ~w[n - 1] : 0;
+        bool ones = !(top & (top + 1));
+        for (uint64_t i = 0; ones && i + 1 < n; ++i) ones = !w[i];
+        len += ones;
+    }
+    while ((1 << bits) < base) ++bits;
+    if ((1 << bits) == base)
+        n = (len + bits - 1) / bits;
+    else
+        n = uint64_t(double(len) / std::log2(double(base))) + 2;
+    return std::max(n, uint64_t(1)) + sign;
+}
+std::to_chars_result BigInt<uint128_t>::ToChars(char* first, char* last,
+                                                int base) const {
+    if (base < 2 || base > 36) return {last, std::errc::invalid_argument};
+    auto charset = Charset(false);
+    bool sign = Sign();
+    if (sign) {
+        if (first == last) return {last, std::errc::value_too_large};
+        *(first++) = '-';
+    }
+    uint64_t bits = 0, n;
+    while ((1 << bits) < base) ++bits;
+    if ((len_ << 1) > TO_CHARS_STACK_LIMIT) {
+        BigInt tmp_obj(*this);
+        if (sign) tmp_obj.ToOpposite();
+        n = tmp_obj.ToCharsSize(base);
+        if (uint64_t(last - first) < n) {
+            // the bound may be loose by a digit or two
+            auto str = tmp_obj.ToString(base, 0);
+            if (uint64_t(last - first) < str.length())
+                return {last, std::errc::value_too_large};
+            return {std::copy(str.begin(), str.end(), first), std::errc()};
         }
-        result.erase(0, result.find_first_not_of('0', 0));
-    } else if (base == 2) {
-        auto it = end_ - 1;
-        uint64_t tmp, mask = uint64_t(1) << 63;
-        int i;
-        if (!*it) --it;
-        auto bufit = buf;
-        if (*(reinterpret_cast<uint64_t*>(it) + 1)) {
-            tmp = *(reinterpret_cast<uint64_t*>(it) + 1);
-            for (i = 0; i < 64; ++i, mask >>= 1)
-                if (mask & tmp) break;
-            for (; i < 64; ++i, mask >>= 1)
-                *(bufit++) = (mask & tmp) ? '1' : '0';
-            tmp = *reinterpret_cast<uint64_t*>(it);
-            mask = uint64_t(1) << 63;
-            for (i = 0; i < 64; ++i, mask >>= 1)
-                *(bufit++) = (mask & tmp) ? '1' : '0';
-            *bufit = '\0';
-        } else {
-            tmp = *reinterpret_cast<uint64_t*>(it);
-            for (i = 0; i < 64; ++i, mask >>= 1)
-                if (mask & tmp) break;
-            for (; i < 64; ++i, mask >>= 1)
-                *(bufit++) = (mask & tmp) ? '1' : '0';
-            *bufit = '\0';
+        if ((1 << bits) == base) {
+            WriteDigitsPow2(tmp_obj, first, 0, n, bits, charset);
+            return {first + n, std::errc()};
         }
-        result.append(buf, bufit - buf);
-        buf[128] = '\0';
-        while (it != val_) {
-            --it;
-            tmp = *(reinterpret_cast<uint64_t*>(it) + 1);
-            for (bufit = buf + 63; bufit >= buf; --bufit, tmp >>= 1)
-                *bufit = (tmp & 1) ? '1' : '0';
-            tmp = *reinterpret_cast<uint64_t*>(it);
-            for (bufit = buf + 127; bufit >= buf + 64; --bufit, tmp >>= 1)
-                *bufit = (tmp & 1) ? '1' : '0';
-            result.append(buf, 128);
+        WriteDigits(tmp_obj, first, n, base, charset,
+                    (len_ << 1) > CONV_WRITE_DC_LIMIT ? ConvPowers(base, n)
+                                                      : std::vector<BigInt>());
+        auto it = std::find_if(first, first + n - 1,
+                               [](char c) { return c != '0'; });
+        // std::copy can not take a destination inside its source
+        if (it == first) return {first + n, std::errc()};
+        return {std::copy(it, first + n, first), std::errc()};
+    }
+    // small, the magnitude and the digits are kept on the stack
+    uint64_t digits[TO_CHARS_STACK_LIMIT], m = len_ << 1, carry = sign;
+    auto src = reinterpret_cast<const uint64_t*>(val_);
+    for (uint64_t i = 0; i < m; ++i) {
+        digits[i] = (sign ? ~src[i] : src[i]) + carry;
+        carry = carry && !digits[i];
+    }
+    while (m && !digits[m - 1]) --m;
+    char buf[TO_CHARS_STACK_LIMIT << 6];
+    char *end = buf + sizeof(buf), *it = end;
+    if ((1 << bits) == base) {
+        for (uint64_t pos = 0; pos < (m << 6); pos += bits) {
+            uint64_t off = pos & 63, v = digits[pos >> 6] >> off;
+            if (off + bits > 64 && (pos >> 6) + 1 < m)
+                v |= digits[(pos >> 6) + 1] << (64 - off);
+            *(--it) = charset[v & ((1 << bits) - 1)];
         }
     } else {
-        auto tmp_obj = *this;
-        int64_t tmp, divbase = base * base * base;
-        divbase *= divbase;
-        divbase *= divbase;  // base^12
-        std::fill(buf, buf + 24, '0');
-        buf[24] = '\0';
-        do {
-            tmp_obj.DivEq64(divbase, &tmp);
-            for (int i = 23; i >= 12; --i) {
-                buf[i] = charset[tmp % base];
-                tmp /= base;
-            }
-            tmp_obj.DivEq64(divbase, &tmp);
-            for (int i = 11; i >= 0; --i) {
-                buf[i] = charset[tmp % base];
-                tmp /= base;
-            }
-            rev_str.append(buf, 24);
-        } while (tmp_obj);
-        for (auto it = rev_str.end() - 24; it >= rev_str.begin(); it -= 24) {
-            result.append(it, it + 24);
+        it = WriteChunks(digits, m, buf, end, base, charset);
+    }
+    while (it + 1 < end && *it == '0') ++it;
+    if (it == end) *(--it) = '0';
+    if (last - first < end - it) return {last, std::errc::value_too_large};
+    return {std::copy(it, end, first), std::errc()};
+}
+size_t BigInt<uint128_t>::FromChars(const char* first, const char* last,
+                                    int base) {
+    if (base < 2 || base > 36) return 0;
+    auto begin = first;
+    if (begin != last && *begin == '-') ++begin;
+    auto it = begin;
+    while (it != last && IsDigit(*it, base)) ++it;
+    if (it == begin) return 0;
+    AssignText(begin, it - begin, base);
+    if (begin != first) ToOpposite();
+    return it - first;
+}
+void BigInt<uint128_t>::PowerBounds(int base, uint64_t k, uint64_t p,
+                                    BigInt* lo, BigInt* hi, uint64_t* e) {
+    *lo = *hi = BigInt(1);
+    *e = 0;
+    auto cut = [&]() {
+        uint64_t bits = hi->BitLen();
+        if (bits <= p) return;
+        *lo >>= bits - p;
+        *hi >>= bits - p;
+        *hi += 1;
+        *e += bits - p;
+    };
+    uint64_t mask = uint64_t(1) << 63;
+    while (!(k & mask)) mask >>= 1;
+    for (; mask; mask >>= 1) {
+        lo->SquareEq();
+        hi->SquareEq();
+        *e <<= 1;
+        cut();
+        if (k & mask) {
+            *lo *= uint64_t(base);
+            *hi *= uint64_t(base);
+            cut();
         }
-        result.erase(0, result.find_first_not_of('0', 0));
     }
-    if (suffix_base && base != 10) {
-        std::sprintf(buf, "_%d", base);
-        result += buf;
+}
+std::string BigInt<uint128_t>::LeadingDigits(uint64_t n, int base) const {
+    if (base < 2 || base > 36) base = 10;
+    if (!n) return std::string();
+    // the whole value if it has at most n digits, or else d - n to drop
+    uint64_t d = DigitCount(base);
+    if (d <= n) {
+        auto str = ToString(base, 0);
+        if (Sign()) str.erase(0, 1);
+        return str;
     }
-    return result;
+    auto a = *this;
+    a.ToAbsolute();
+    uint64_t k = d - n;
+    // the quotient is fixed by a's top bits and a p-bit base^k, unless it
+    // sits within the rounding error of an integer
+    uint64_t p = uint64_t(double(n) * std::log2(double(base))) + 128;
+    uint64_t s = a.BitLen() > p + 64 ? a.BitLen() - p - 64 : 0;
+    auto top = a >> s;
+    BigInt q, q_hi, lo, hi;
+    uint64_t e;
+    PowerBounds(base, k, p, &lo, &hi, &e);
+    if (s >= e) {
+        q = (top << (s - e)) / hi;
+        q_hi = ((top + 1) << (s - e)) / lo;
+    } else {
+        q = top / (hi << (e - s));
+        q_hi = (top + 1) / (lo << (e - s));
+    }
+    if (q < q_hi) q = a / Power(BigInt(base), k);
+    return q.ToString(base, 0);
+}
+std::string BigInt<uint128_t>::TrailingDigits(uint64_t n, int base) const {
+    if (base < 2 || base > 36) base = 10;
+    if (!n) return std::string();
+    // the whole value if it has at most n digits, base^n only otherwise
+    if (DigitCount(base) <= n) {
+        auto str = ToString(base, 0);
+        if (Sign()) str.erase(0, 1);
+        return str;
+    }
+    auto a = *this;
+    a.ToAbsolute();
+    a %= Power(BigInt(base), n);
+    auto str = a.ToString(base, 0);
+    return std::string(n - str.length(), '0') + str;
 }
 BigInt<uint128_t>::BigInt(const std::string& str, size_t base)
     : BigInt(str.c_str(), base) {}
 BigInt<uint128_t>::BigInt(const char* str, size_t base) : BigInt(0) {
-    const uint64_t decode[75] = {
-        0,  1,  2,  3,  4,  5,  6,  7,  8,  9,  64, 64, 64, 64, 64,
-        64, 64, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22,
-        23, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 64, 64,
-        64, 64, 64, 64, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20,
-        21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35};
     bool bNegative = false;
     uint64_t p = 0;
     if (str[p] == '-') {
@@ -322,111 +748,183 @@ BigInt<uint128_t>::BigInt(const char* str, size_t base) : BigInt(0) {
         }
     }
     if (base > 36 || base < 2) base = 10;
-    uint64_t buf = 0, t = 0, basebound = base;
-    int i = 0;
-    if (base == 16) {
-        while (std::isxdigit(str[p])) {
-            buf = (buf << 4) | decode[int(str[p] - '0')];
-            ++p;
-            i += 4;
-            if (i >= 64) {
-                *this <<= 64;
-                *this += buf;
-                buf = 0;
-                i = 0;
-            }
+    auto begin = str + p;
+    while (IsDigit(str[p], int(base))) ++p;
+    AssignText(begin, str + p - begin, int(base));
+    if (bNegative) ToOpposite();
+}
+std::istream& operator>>(std::istream& in, BigInt<uint128_t>& rhs) {
+    using BI = BigInt<uint128_t>;
+    std::istream::sentry sentry(in);
+    if (!sentry) return in;
+    auto sb = in.rdbuf();
+    auto eof = std::char_traits<char>::eof();
+    uint64_t base = (in.flags() & in.hex) ? 16 : (in.flags() & in.oct) ? 8 : 0;
+    int c = sb->sgetc();
+    bool negative = c == '-', digits = false;
+    if (c == '-' || c == '+') c = sb->snextc();
+    if (c == '0') {
+        digits = true;
+        c = sb->snextc();
+        if ((base == 0 || base == 2) && (c == 'B' || c == 'b')) {
+            base = 2;
+            c = sb->snextc();
+        } else if ((base == 0 || base == 16) && (c == 'X' || c == 'x')) {
+            base = 16;
+            c = sb->snextc();
+        } else if (base == 0) {
+            base = 8;
         }
-        if (i) {
-            *this <<= i;
-            *this += buf;
+    }
+    if (base == 0) base = 10;
+    uint64_t bits = 0;
+    while ((uint64_t(1) << bits) < base) ++bits;
+    if ((uint64_t(1) << bits) != base) bits = 0;
+    // full blocks are merged like a binary counter, the block at level t
+    // spans 2^t blocks and is scaled by pow[t] = base^(STREAM_BLOCK*2^t)
+    std::vector<BI> stack, pow;
+    std::vector<uint64_t> level;
+    std::vector<char> buf(BI::STREAM_BLOCK + 1);
+    auto scale = [&](BI& x, uint64_t t) {
+        if (bits) {
+            x <<= (bits * BI::STREAM_BLOCK) << t;
+            return;
         }
-    } else if (base == 8) {
-        while (std::isdigit(str[p]) && (t = str[p] - '0') < base) {
-            buf = (buf << 3) | t;
-            ++p;
-            i += 3;
-            if (i >= 63) {
-                *this <<= 63;
-                *this += buf;
-                buf = 0;
-                i = 0;
-            }
+        if (pow.empty())
+            pow.push_back(Power(BI(base), BI::STREAM_BLOCK));
+        while (pow.size() <= t) pow.push_back(BI::Square(pow.back()));
+        x *= pow[t];
+    };
+    uint64_t len = 0;
+    while (true) {
+        if (c != eof && IsDigit(char(c), int(base))) {
+            buf[len++] = char(c);
+            c = sb->snextc();
+            if (len != BI::STREAM_BLOCK) continue;
         }
-        if (i) {
-            *this <<= i;
-            *this += buf;
+        if (len != BI::STREAM_BLOCK) break;
+        buf[len] = '\0';
+        stack.emplace_back(buf.data(), base);
+        level.push_back(0);
+        len = 0;
+        digits = true;
+        while (level.size() > 1 && level.back() == level[level.size() - 2]) {
+            auto t = level.back();
+            scale(stack[stack.size() - 2], t);
+            stack[stack.size() - 2] += stack.back();
+            stack.pop_back();
+            level.pop_back();
+            ++level.back();
         }
-    } else if (base == 10) {
-        basebound = 1000000000;
-        basebound *= basebound;  // 10^18
-        while (std::isdigit(str[p])) {
-            buf = buf * base + (str[p] - '0');
-            ++p;
-            ++i;
-            if (i >= 18) {
-                *this *= basebound;
-                *this += buf;
-                buf = 0;
-                i = 0;
+    }
+    if (c == eof) in.setstate(in.eofbit);
+    if (!digits && !len) {
+        in.setstate(in.failbit);
+        return in;
+    }
+    BI result;
+    for (size_t i = 0; i < stack.size(); ++i) {
+        scale(result, level[i]);
+        result += stack[i];
+    }
+    if (len) {
+        buf[len] = '\0';
+        if (bits)
+            result <<= bits * len;
+        else
+            result *= Power(BI(base), len);
+        result += BI(buf.data(), base);
+    }
+    if (negative) result.ToOpposite();
+    rhs = std::move(result);
+    return in;
+}
+static bool IsFieldEnd(char c, char delim) {
+    return c == delim || c == '\n' || c == '\r';
+}
+bool ParseBatch(const char* first, const char* last,
+                std::vector<BigInt<uint128_t>>* out, char delim, int base) {
+    out->clear();
+    if (base < 2 || base > 36) return false;
+    uint64_t size = last - first, pieces = size / BATCH_CHARS + 1;
+    // the shared pool only for more than one piece
+    if (pieces > 1)
+        pieces = std::min<uint64_t>(WorkerPool::Shared().Threads() << 2,
+                                    pieces);
+    // pieces end on a separator, so no field is split
+    std::vector<const char*> cut(pieces + 1, last);
+    cut[0] = first;
+    for (uint64_t i = 1; i < pieces; ++i) {
+        auto it = std::max(first + size * i / pieces, cut[i - 1]);
+        while (it != last && !IsFieldEnd(*it, delim)) ++it;
+        cut[i] = it;
+    }
+    // fields counted first, then each piece parses into its own slots
+    std::vector<uint64_t> pos(pieces + 1);
+    SharedParallelFor(pieces, 1, [&](uint64_t begin, uint64_t end) {
+        for (uint64_t i = begin; i < end; ++i) {
+            bool in_field = false;
+            for (auto it = cut[i]; it != cut[i + 1]; ++it) {
+                bool sep = IsFieldEnd(*it, delim);
+                pos[i + 1] += !sep && !in_field;
+                in_field = !sep;
             }
         }
-        if (i) {
-            basebound = base;
-            while (--i) basebound *= base;
-            *this *= basebound;
-            *this += buf;
-        }
-    } else if (base == 2) {
-        while (str[p] == '0' || str[p] == '1') {
-            buf = (buf << 1) | (str[p] == '1');
-            ++p;
-            ++i;
-            if (i >= 64) {
-                *this <<= 64;
-                *this += buf;
-                buf = 0;
-                i = 0;
+    });
+    for (uint64_t i = 0; i < pieces; ++i) pos[i + 1] += pos[i];
+    out->resize(pos[pieces]);
+    std::atomic<bool> ok{true};
+    SharedParallelFor(pieces, 1, [&](uint64_t begin, uint64_t end) {
+        for (uint64_t i = begin; i < end; ++i) {
+            auto x = out->data() + pos[i];
+            for (auto it = cut[i], term = cut[i + 1]; it != term;) {
+                if (IsFieldEnd(*it, delim)) {
+                    ++it;
+                    continue;
+                }
+                auto field = it;
+                while (it != term && !IsFieldEnd(*it, delim)) ++it;
+                if ((x++)->FromChars(field, it, base) != size_t(it - field))
+                    ok = false;
             }
         }
-        if (i) {
-            *this <<= i;
-            *this += buf;
-        }
-    } else {
-        basebound = base * base * base;
-        basebound *= basebound;
-        basebound *= basebound;  // base^12
-        while (std::isalnum(str[p]) && (t = decode[str[p] - '0']) < base) {
-            buf = buf * base + t;
-            ++p;
-            ++i;
-            if (i >= 12) {
-                *this *= basebound;
-                *this += buf;
-                buf = 0;
-                i = 0;
+    });
+    if (!ok) out->clear();
+    return ok;
+}
+std::string FormatBatch(const BigInt<uint128_t>* values, size_t n,
+                        char delim, int base) {
+    if (base < 2 || base > 36) base = 10;
+    uint64_t pieces = n / BATCH_VALUES + 1;
+    if (pieces > 1)
+        pieces = std::min<uint64_t>(WorkerPool::Shared().Threads() << 2,
+                                    pieces);
+    // each piece formats into its own buffer, joined at last
+    std::vector<std::string> part(pieces);
+    SharedParallelFor(pieces, 1, [&](uint64_t begin, uint64_t end) {
+        for (uint64_t i = begin; i < end; ++i) {
+            auto& str = part[i];
+            uint64_t used = 0;
+            for (uint64_t j = n * i / pieces; j < n * (i + 1) / pieces; ++j) {
+                uint64_t need = values[j].ToCharsSize(base) + 1;
+                if (str.size() < used + need)
+                    str.resize(std::max(str.size() << 1, used + need));
+                auto res = values[j].ToChars(&str[used], &str[used] + need - 1,
+                                             base);
+                *res.ptr = delim;
+                used = res.ptr + 1 - str.data();
             }
+            str.resize(used);
         }
-        if (i) {
-            basebound = base;
-            while (--i) basebound *= base;
-            *this *= basebound;
-            *this += buf;
-        }
-    }
-    if (bNegative) ToOpposite();
-}
-std::istream& operator>>(std::istream& in, BigInt<uint128_t>& rhs) {
-    std::string str;
-    in >> str;
-    if (in.flags() & in.hex) {
-        rhs = BigInt<uint128_t>(str.c_str(), 16);
-    } else if (in.flags() & in.oct) {
-        rhs = BigInt<uint128_t>(str.c_str(), 8);
-    } else {
-        // auto-detect
-        rhs = BigInt<uint128_t>(str.c_str(), 0);
-    }
-    return in;
+    });
+    std::vector<uint64_t> pos(pieces + 1);
+    for (uint64_t i = 0; i < pieces; ++i)
+        pos[i + 1] = pos[i] + part[i].size();
+    std::string result(pos[pieces], '\0');
+    SharedParallelFor(pieces, 1, [&](uint64_t begin, uint64_t end) {
+        for (uint64_t i = begin; i < end; ++i)
+            std::copy(part[i].begin(), part[i].end(), &result[pos[i]]);
+    });
+    return result;
 }
 }  // namespace calc
@@ -146,6 +146,77 @@ const CompMp CompMp::WN[CompMp::P] = {
     CompMp(49, 1177171008151898599),
     CompMp(5, 348301401736559255)};
 
+uint64_t BigInt<uint128_t>::AddMul64(uint64_t* dest, const uint64_t* src,
+                                     uint64_t n, uint64_t q) {
+    // dest[0..n) += src[0..n) * q, return the carry out of dest[n-1]
+    uint128_t prod = 0;
+    for (uint64_t i = 0; i < n; ++i) {
+        prod = uint128_t(src[i]) * q + dest[i] + uint64_t(prod >> 64);
+        dest[i] = prod;
+    }
+    return prod >> 64;
+}
+uint64_t BigInt<uint128_t>::MulAdd64(uint64_t* dest, uint64_t n, uint64_t q,
+                                     uint64_t c) {
+    // dest[0..n) = dest[0..n) * q + c, return the carry out of dest[n-1]
+    uint128_t prod;
+    for (uint64_t i = 0; i < n; ++i) {
+        prod = uint128_t(dest[i]) * q + c;
+        dest[i] = prod;
+        c = prod >> 64;
+    }
+    return c;
+}
+void BigInt<uint128_t>::MulBase64(uint64_t* dest, const uint64_t* a,
+                                  uint64_t an, const uint64_t* b,
+                                  uint64_t bn) {
+    // dest[0..an+bn) = a*b, schoolbook
+    std::fill(dest, dest + an, 0);
+    for (uint64_t i = 0; i < bn; ++i)
+        dest[an + i] = AddMul64(dest + i, a, an, b[i]);
+}
+void BigInt<uint128_t>::MulKara64(uint64_t* dest, const uint64_t* a,
+                                  uint64_t an, const uint64_t* b, uint64_t bn,
+                                  uint64_t* tmp) {
+    // dest[0..an+bn) = a*b, require an >= bn,
+    // tmp should have at least 6*an+256 digits
+    if (bn < MUL_KARA_LIMIT) return MulBase64(dest, a, an, b, bn);
+    uint64_t h = (an + 1) >> 1;
+    if (bn <= h) {
+        // unbalanced: a0*b + a1*b*2^(64h)
+        MulKara64(dest, a, h, b, bn, tmp);
+        auto t = tmp;
+        if (an - h >= bn)
+            MulKara64(t, a + h, an - h, b, bn, tmp + an + bn);
+        else
+            MulKara64(t, b, bn, a + h, an - h, tmp + an + bn);
+        std::fill(dest + h + bn, dest + an + bn, 0);
+        AddN64(dest + h, t, an - h + bn);
+        return;
+    }
+    // a0*b0 + ((a0+a1)*(b0+b1)-a0*b0-a1*b1)*2^(64h) + a1*b1*2^(128h)
+    auto sa = tmp, sb = tmp + h + 1, z1 = tmp + 2 * (h + 1);
+    auto next = z1 + 2 * (h + 1);
+    std::copy(a, a + h, sa);
+    sa[h] = AddN64(sa, a + h, an - h);
+    for (uint64_t k = an - h; sa[h] && k < h; ++k) sa[h] = !++sa[k];
+    std::copy(b, b + h, sb);
+    sb[h] = AddN64(sb, b + h, bn - h);
+    for (uint64_t k = bn - h; sb[h] && k < h; ++k) sb[h] = !++sb[k];
+    MulKara64(dest, a, h, b, h, next);
+    MulKara64(dest + 2 * h, a + h, an - h, b + h, bn - h, next);
+    MulKara64(z1, sa, h + 1, sb, h + 1, next);
+    if (SubN64(z1, dest, 2 * h))
+        for (uint64_t k = 2 * h; !z1[k]--; ++k)
+            ;
+    if (SubN64(z1, dest + 2 * h, an + bn - 2 * h))
+        for (uint64_t k = an + bn - 2 * h; !z1[k]--; ++k)
+            ;
+    // z1 fits in 2h+1 digits
+    if (AddN64(dest + h, z1, std::min(2 * h + 1, an + bn - h)))
+        for (uint64_t k = 3 * h + 1; !++dest[k]; ++k)
+            ;
+}
 BigInt<uint128_t>& BigInt<uint128_t>::operator*=(uint64_t rhs) {
     bool sign = Sign();
     if (sign) ToOpposite();
@@ -154,7 +225,8 @@ BigInt<uint128_t>& BigInt<uint128_t>::operator*=(uint64_t rhs) {
     uint128_t* it = val_;
     uint128_t* rit = carry.val_;
     do {
-        asm("movq (%0), %%rax\n\t"
+        asm volatile(
+            "movq (%0), %%rax\n\t"
             "mulq %2\n\t"
             "movq %%rax, (%0)\n\t"
             "movq %%rdx, 8(%1)\n\t"
@@ -174,41 +246,53 @@ BigInt<uint128_t>& BigInt<uint128_t>::operator*=(uint64_t rhs) {
     ShrinkLen();
     return *this;
 }
-BigInt<uint128_t>& BigInt<uint128_t>::RMNTMulEq(const BigInt& rhs) {
+template <typename T>
+void BigInt<uint128_t>::LoadDigits16(T* dest, uint64_t n, const uint64_t* a,
+                                     uint64_t an) {
+    auto it = reinterpret_cast<const uint16_t*>(a);
+    auto term = reinterpret_cast<const uint16_t*>(a + an);
+    auto vit = dest;
+    for (; it < term; vit += 4, it += 4) {
+        for (int j = 0; j < 4; ++j) *(vit + j) = T(*(it + j));
+    }
+    std::fill(vit, dest + n, T());
+}
+template <typename T>
+void BigInt<uint128_t>::LoadDigits16(T* dest, uint64_t n, const BigInt& x) {
     // reinterpret as uint16
-    if (rhs.Sign()) {
-        RMNTMulEq(-rhs);
-        return ToOpposite();
+    auto it = reinterpret_cast<const uint16_t*>(x.val_);
+    auto term = reinterpret_cast<const uint16_t*>(x.end_);
+    auto vit = dest;
+    if (x.Sign()) {
+        // negated on the way in, so -x is never formed
+        uint32_t c = 1;
+        for (; it < term; ++vit, ++it) {
+            c += uint16_t(~*it);
+            *vit = T(uint16_t(c));
+            c >>= 16;
+        }
+    } else {
+        for (; it < term; vit += 8, it += 8) {
+            for (int j = 0; j < 8; j += 2) {
+                *(vit + j) = T(*(it + j));
+                *(vit + j + 1) = T(*(it + j + 1));
+            }
+        }
     }
-    bool sign = Sign();
-    if (sign) ToOpposite();
+    std::fill(vit, dest + n, T());
+}
+BigInt<uint128_t>& BigInt<uint128_t>::RMNTMulEq(const BigInt& rhs) {
+    // on the magnitudes, the sign is applied to the product
+    bool sign = Sign() != rhs.Sign();
     int64_t* v[2];
     uint64_t n = 1;
-    auto it = reinterpret_cast<uint16_t*>(val_);
-    auto cit = reinterpret_cast<uint16_t*>(rhs.val_);
-    auto term = reinterpret_cast<uint16_t*>(end_);
-    auto cterm = reinterpret_cast<uint16_t*>(rhs.end_);
     while (n < len_ + rhs.len_) n <<= 1;
     // 128/16=8
     n <<= 3;
-    v[0] = new int64_t[n];
-    v[1] = new int64_t[n];
-    auto vit = v[0];
-    for (; it < term; vit += 8, it += 8) {
-        for (int j = 0; j < 8; j += 2) {
-            *(vit + j) = *(it + j);
-            *(vit + j + 1) = *(it + j + 1);
-        }
-    }
-    std::fill(vit, v[0] + n, 0);
-    vit = v[1];
-    for (; cit < cterm; vit += 8, cit += 8) {
-        for (int j = 0; j < 8; j += 2) {
-            *(vit + j) = *(cit + j);
-            *(vit + j + 1) = *(cit + j + 1);
-        }
-    }
-    std::fill(vit, v[1] + n, 0);
+    v[0] = NewScratch<int64_t>(n);
+    v[1] = NewScratch<int64_t>(n);
+    LoadDigits16(v[0], n, *this);
+    LoadDigits16(v[1], n, rhs);
     RMNT(v[0], n, false);
     RMNT(v[1], n, false);
     int64_t t1, t2, t3, t4;
@@ -225,10 +309,12 @@ BigInt<uint128_t>& BigInt<uint128_t>::RMNTMulEq(const BigInt& rhs) {
         v[0][n - i] = CompMp::ModMp(int128_t(t2) * t3 + int128_t(t1) * t4);
     }
     RMNT(v[0], n, true);
-    SetLen(len_ + rhs.len_ + 1, true);
-    it = reinterpret_cast<uint16_t*>(val_);
-    term = reinterpret_cast<uint16_t*>(end_ - 1);
-    vit = v[0];
+    // the product overwrites everything but the top limb
+    SetLenUninit(len_ + rhs.len_ + 1);
+    *(end_ - 1) = 0;
+    auto it = reinterpret_cast<uint16_t*>(val_);
+    auto term = reinterpret_cast<uint16_t*>(end_ - 1);
+    auto vit = v[0];
     uint64_t tmp = 0;
     for (; it != term; it += 8, vit += 8) {
         for (int j = 0; j < 8; j += 2) {
@@ -242,8 +328,8 @@ BigInt<uint128_t>& BigInt<uint128_t>::RMNTMulEq(const BigInt& rhs) {
     }
     if (sign) ToOpposite();
     ShrinkLen();
-    delete[] v[0];
-    delete[] v[1];
+    DeleteScratch(v[1], n);
+    DeleteScratch(v[0], n);
     return *this;
 }
 template <typename T>
@@ -329,49 +415,27 @@ void BigInt<uint128_t>::RMNT(int64_t* dest, uint64_t n, bool inv) {
         for (i = 0; i < n; ++i) dest[i] = T::ModMp(int128_t(dest[i]) << mov);
 }
 BigInt<uint128_t>& BigInt<uint128_t>::MNTMulEq(const BigInt& rhs) {
-    if (rhs.Sign()) {
-        MNTMulEq(-rhs);
-        ToOpposite();
-        return *this;
-    }
-    bool sign = Sign();
-    if (sign) ToOpposite();
+    bool sign = Sign() != rhs.Sign();
     using T = CompMp;
     T* v[2];
     uint64_t n = 1;
-    auto it = reinterpret_cast<uint16_t*>(val_);
-    auto cit = reinterpret_cast<uint16_t*>(rhs.val_);
-    auto term = reinterpret_cast<uint16_t*>(end_);
-    auto cterm = reinterpret_cast<uint16_t*>(rhs.end_);
     while (n < len_ + rhs.len_) n <<= 1;
     // 128/16=8
     n <<= 3;
-    v[0] = new T[n];
-    v[1] = new T[n];
-    auto vit = v[0];
-    for (; it < term; vit += 8, it += 8) {
-        for (int j = 0; j < 8; j += 2) {
-            *(vit + j) = T(*(it + j));
-            *(vit + j + 1) = T(*(it + j + 1));
-        }
-    }
-    std::fill(vit, v[0] + n, T());
-    vit = v[1];
-    for (; cit < cterm; vit += 8, cit += 8) {
-        for (int j = 0; j < 8; j += 2) {
-            *(vit + j) = T(*(cit + j));
-            *(vit + j + 1) = T(*(cit + j + 1));
-        }
-    }
-    std::fill(vit, v[1] + n, T());
+    v[0] = NewScratch<T>(n);
+    v[1] = NewScratch<T>(n);
+    LoadDigits16(v[0], n, *this);
+    LoadDigits16(v[1], n, rhs);
     MNT(v[0], n, false);
     MNT(v[1], n, false);
     for (uint64_t i = 0; i < n; ++i) v[0][i] *= v[1][i];
     MNT(v[0], n, true);
-    SetLen(len_ + rhs.len_ + 1, true);
-    it = reinterpret_cast<uint16_t*>(val_);
-    term = reinterpret_cast<uint16_t*>(end_ - 1);
-    vit = v[0];
+    // the product overwrites everything but the top limb
+    SetLenUninit(len_ + rhs.len_ + 1);
+    *(end_ - 1) = 0;
+    auto it = reinterpret_cast<uint16_t*>(val_);
+    auto term = reinterpret_cast<uint16_t*>(end_ - 1);
+    auto vit = v[0];
     uint64_t tmp = 0;
     for (; it != term; it += 8, vit += 8) {
         for (int j = 0; j < 8; j += 2) {
@@ -383,8 +447,8 @@ BigInt<uint128_t>& BigInt<uint128_t>::MNTMulEq(const BigInt& rhs) {
     }
     if (sign) ToOpposite();
     ShrinkLen();
-    delete[] v[0];
-    delete[] v[1];
+    DeleteScratch(v[1], n);
+    DeleteScratch(v[0], n);
     return *this;
 }
 void BigInt<uint128_t>::MNT(CompMp* dest, uint64_t n, bool inv) {
@@ -415,88 +479,51 @@ void BigInt<uint128_t>::MNT(CompMp* dest, uint64_t n, bool inv) {
 BigInt<uint128_t>& BigInt<uint128_t>::MulEqKaratsuba(const BigInt& rhs) {
     // if (len_ <= 2 || rhs.len_ <= 2) return PlainMulEq(rhs);
     if (len_ <= 4 || rhs.len_ <= 4) return RMNTMulEq(rhs);
-    if (rhs.Sign()) {
-        MulEqKaratsuba(-rhs);
-        ToOpposite();
-        return *this;
-    }
-    bool sign = Sign();
-    if (sign) ToOpposite();
-    size_t t = (std::max(rhs.len_, len_) + 1) >> 1;
-    BigInt<uint128_t> a, b, c, d, x, y, z;
-    if (t >= len_) {
-        b.SetLen(len_, false);
-        std::copy(val_, end_, b.val_);
-    } else {
-        b.SetLen(t + 1, false);
-        std::copy(val_, val_ + t, b.val_);
-        b.ShrinkLen();
-        a.SetLen(len_ - t, false);
-        std::copy(val_ + t, end_, a.val_);
-    }
-    if (t >= rhs.len_) {
-        d.SetLen(rhs.len_, false);
-        std::copy(rhs.val_, rhs.end_, d.val_);
-    } else {
-        d.SetLen(t + 1, false);
-        std::copy(rhs.val_, rhs.val_ + t, d.val_);
-        d.ShrinkLen();
-        c.SetLen(rhs.len_ - t, false);
-        std::copy(rhs.val_ + t, rhs.end_, c.val_);
-    }
-    if (t >= len_) {
-        d.MulEqKaratsuba(b);
-        c.MulEqKaratsuba(b);
-        // d *= b;
-        // c *= b;
-        *this = std::move(d);
-        BiasedAddEq(c, t);
-    } else if (t >= rhs.len_) {
-        a.MulEqKaratsuba(d);
-        b.MulEqKaratsuba(d);
-        // b *= d;
-        // a *= d;
-        *this = std::move(b);
-        BiasedAddEq(a, t);
-    } else {
-        x = a + b;
-        x.MulEqKaratsuba(c + d);
-        a.MulEqKaratsuba(c);
-        b.MulEqKaratsuba(d);
-        // x = (a + b) * (c + d);
-        // a *= c;
-        // b *= d;
-        x -= a;
-        x -= b;
-        *this = std::move(b);
-        BiasedAddEq(a, t + t);
-        BiasedAddEq(x, t);
-    }
-    if (sign) ToOpposite();
+    bool sign = Sign(), rhs_sign = rhs.Sign();
+    uint64_t len = len_, rlen = rhs.len_;
+    // the recursion works on uint64 digits in one scratch block sized from
+    // the lengths, instead of BigInt temporaries at every level
+    ScratchScope scope(((len + rlen) << 5) +
+                       (12 * std::max(len, rlen) + 256) * sizeof(uint64_t) +
+                       256);
+    auto ma = Magnitude(*this), mb = Magnitude(rhs);
+    auto a = reinterpret_cast<const uint64_t*>(ma);
+    auto b = reinterpret_cast<const uint64_t*>(mb);
+    uint64_t an = len << 1, bn = rlen << 1;
+    while (an > 1 && !a[an - 1]) --an;
+    while (bn > 1 && !b[bn - 1]) --bn;
+    if (an < bn) {
+        std::swap(a, b);
+        std::swap(an, bn);
+    }
+    uint64_t tn = 6 * an + 256;
+    auto dest = NewScratch<uint64_t>(an + bn);
+    auto tmp = NewScratch<uint64_t>(tn);
+    MulKara64(dest, a, an, b, bn, tmp);
+    AssignDigits(dest, an + bn, sign != rhs_sign);
+    DeleteScratch(tmp, tn);
+    DeleteScratch(dest, an + bn);
+    if (rhs_sign) DeleteScratch(mb, rlen);
+    if (sign) DeleteScratch(ma, len);
     return *this;
 }
 BigInt<uint128_t>& BigInt<uint128_t>::PlainMulEq(const BigInt& rhs) {
-    if (rhs.Sign()) {
-        PlainMulEq(-rhs);
-        return ToOpposite();
-    }
-    bool sign = Sign();
-    if (sign) ToOpposite();
-    BigInt<uint128_t> save_this = std::move(*this);
-    auto cit = reinterpret_cast<uint64_t*>(rhs.val_);
-    uint64_t i = 0;
-    auto cterm = reinterpret_cast<uint64_t*>(rhs.end_);
-    if (!*(rhs.end_ - 1)) cterm -= 2;
-    *this = BigInt<uint128_t>(0);
-    do {
-        BiasedAddEq(save_this * (*cit), i, false);
-        ++cit;
-        BiasedAddEq(save_this * (*cit), i, true);
-        ++cit;
-        ++i;
-    } while (cit < cterm);
-    if (sign) ToOpposite();
-    ShrinkLen();
+    // schoolbook on the magnitudes into scratch, then back into this
+    // storage with the sign of the product
+    bool sign = Sign(), rhs_sign = rhs.Sign();
+    uint64_t len = len_, rlen = rhs.len_;
+    auto ma = Magnitude(*this), mb = Magnitude(rhs);
+    auto a = reinterpret_cast<const uint64_t*>(ma);
+    auto b = reinterpret_cast<const uint64_t*>(mb);
+    uint64_t an = len << 1, bn = rlen << 1;
+    while (an > 1 && !a[an - 1]) --an;
+    while (bn > 1 && !b[bn - 1]) --bn;
+    auto dest = NewScratch<uint64_t>(an + bn);
+    MulBase64(dest, a, an, b, bn);
+    AssignDigits(dest, an + bn, sign != rhs_sign);
+    DeleteScratch(dest, an + bn);
+    if (rhs_sign) DeleteScratch(mb, rlen);
+    if (sign) DeleteScratch(ma, len);
     return *this;
 }
 BigInt<uint128_t>& BigInt<uint128_t>::operator*=(const BigInt& rhs) {
@@ -510,22 +537,12 @@ BigInt<uint128_t>& BigInt<uint128_t>::operator*=(const BigInt& rhs) {
 }
 BigInt<uint128_t>& BigInt<uint128_t>::SquareEq() {
     // specialized version of RMNTMulEq
-    if (Sign()) ToOpposite();
     int64_t* v;
     uint64_t n = 1;
-    auto it = reinterpret_cast<uint16_t*>(val_);
-    auto term = reinterpret_cast<uint16_t*>(end_);
     while (n < len_) n <<= 1;
     n <<= 4;
-    v = new int64_t[n];
-    auto vit = v;
-    for (; it < term; vit += 8, it += 8) {
-        for (int j = 0; j < 8; j += 2) {
-            *(vit + j) = *(it + j);
-            *(vit + j + 1) = *(it + j + 1);
-        }
-    }
-    std::fill(vit, v + n, 0);
+    v = NewScratch<int64_t>(n);
+    LoadDigits16(v, n, *this);
     RMNT(v, n, false);
     int64_t t1, t2, t3, t4;
     uint64_t n2 = n >> 1;
@@ -542,10 +559,12 @@ BigInt<uint128_t>& BigInt<uint128_t>::SquareEq() {
         v[n - i] = (t4 & CompMp::MP) + (t4 >> CompMp::P);
     }
     RMNT(v, n, true);
-    SetLen(len_ + len_ + 1, true);
-    it = reinterpret_cast<uint16_t*>(val_);
-    term = reinterpret_cast<uint16_t*>(end_ - 1);
-    vit = v;
+    // the product overwrites everything but the top limb
+    SetLenUninit(len_ + len_ + 1);
+    *(end_ - 1) = 0;
+    auto it = reinterpret_cast<uint16_t*>(val_);
+    auto term = reinterpret_cast<uint16_t*>(end_ - 1);
+    auto vit = v;
     uint64_t tmp = 0;
     for (; it != term; it += 8, vit += 8) {
         for (int j = 0; j < 8; j += 2) {
@@ -558,26 +577,14 @@ BigInt<uint128_t>& BigInt<uint128_t>::SquareEq() {
         }
     }
     ShrinkLen();
-    delete[] v;
+    DeleteScratch(v, n);
     return *this;
 }
-BigInt<uint128_t>& BigInt<uint128_t>::RMNTMulEqGiven(const int64_t* src,
-                                                     uint64_t n,
-                                                     uint64_t rlen) {
-    // require len_ <= (length of the pre-converted number)
-    bool sign = Sign();
-    if (sign) ToOpposite();
-    auto* v = new int64_t[n];
-    auto it = reinterpret_cast<uint16_t*>(val_);
-    auto term = reinterpret_cast<uint16_t*>(end_);
-    auto vit = v;
-    for (; it < term; vit += 8, it += 8) {
-        for (int j = 0; j < 8; j += 2) {
-            *(vit + j) = *(it + j);
-            *(vit + j + 1) = *(it + j + 1);
-        }
-    }
-    std::fill(vit, v + n, 0);
+void BigInt<uint128_t>::MulGiven64(uint64_t* dest, uint64_t dn,
+                                   const uint64_t* a, uint64_t an,
+                                   const int64_t* src, uint64_t n,
+                                   int64_t* v) {
+    LoadDigits16(v, n, a, an);
     RMNT(v, n, false);
     int64_t t1, t2, t3, t4;
     uint64_t n2 = n >> 1;
@@ -593,113 +600,68 @@ BigInt<uint128_t>& BigInt<uint128_t>::RMNTMulEqGiven(const int64_t* src,
         v[n - i] = CompMp::ModMp(int128_t(t2) * t3 + int128_t(t1) * t4);
     }
     RMNT(v, n, true);
-    SetLen(len_ + rlen + 1, true);
-    it = reinterpret_cast<uint16_t*>(val_);
-    term = reinterpret_cast<uint16_t*>(end_ - 1);
-    vit = v;
+    auto it = reinterpret_cast<uint16_t*>(dest);
+    auto term = reinterpret_cast<uint16_t*>(dest + dn);
+    auto vit = v;
     uint64_t tmp = 0;
-    for (; it < term; it += 8, vit += 8) {
-        for (int j = 0; j < 8; j += 2) {
+    for (; it < term; it += 4, vit += 4) {
+        for (int j = 0; j < 4; ++j) {
             if (*(vit + j) >= CompMp::MP) *(vit + j) -= CompMp::MP;
             tmp = (tmp >> 16) + uint64_t(*(vit + j));
             *(it + j) = uint16_t(tmp);
-            if (*(vit + j + 1) >= CompMp::MP) *(vit + j + 1) -= CompMp::MP;
-            tmp = (tmp >> 16) + uint64_t(*(vit + j + 1));
-            *(it + j + 1) = uint16_t(tmp);
         }
     }
-    if (sign) ToOpposite();
-    ShrinkLen();
-    delete[] v;
-    return *this;
+}
+void BigInt<uint128_t>::MulFFT64(uint64_t* dest, const uint64_t* a,
+                                 uint64_t an, const uint64_t* b,
+                                 uint64_t bn) {
+    // 64/16=4
+    uint64_t n = 1;
+    while (n < an + bn) n <<= 1;
+    n <<= 2;
+    auto src = NewScratch<int64_t>(n);
+    auto v = NewScratch<int64_t>(n);
+    LoadDigits16(src, n, b, bn);
+    RMNT(src, n, false);
+    MulGiven64(dest, an + bn, a, an, src, n, v);
+    DeleteScratch(v, n);
+    DeleteScratch(src, n);
 }
 BigInt<uint128_t>& BigInt<uint128_t>::RMNTMulEqUB(const BigInt& rhs) {
-    // reinterpret as uint16
-    if (rhs.Sign()) {
-        RMNTMulEqUB(-rhs);
-        return ToOpposite();
-    }
-    bool sign = Sign();
-    if (sign) ToOpposite();
-    int64_t* v;
+    // the long operand is read in chunks of the length of the short one
+    // straight from its limbs, each multiplied by the short one
+    // transformed once and added into place
+    bool sign = Sign() != rhs.Sign();
+    bool this_long = len_ > rhs.len_;
+    uint64_t slen = this_long ? rhs.len_ : len_;
     uint64_t n = 1;
-    uint64_t k, i;
-    BigInt<uint128_t> tmp_obj;
-    if (len_ > rhs.len_) {
-        auto cit = reinterpret_cast<uint16_t*>(rhs.val_);
-        auto cterm = reinterpret_cast<uint16_t*>(rhs.end_);
-        while (n <= rhs.len_) n <<= 1;
-        n <<= 4;
-        k = (len_ + rhs.len_ - 1) / rhs.len_;
-        v = new int64_t[n];
-        auto vit = v;
-        for (; cit < cterm; vit += 8, cit += 8) {
-            for (int j = 0; j < 8; j += 2) {
-                *(vit + j) = *(cit + j);
-                *(vit + j + 1) = *(cit + j + 1);
-            }
-        }
-        std::fill(vit, v + n, 0);
-        RMNT(v, n, false);
-        BigInt<uint128_t> save_this = std::move(*this);
-        auto sit = save_this.val_;
-        auto sterm = save_this.end_;
-        *this = BigInt<uint128_t>(0);
-        for (i = 0; i < k - 1; ++i) {
-            tmp_obj.SetLen(rhs.len_ + 1, false);
-            *(tmp_obj.end_ - 1) = 0;
-            std::copy(sit, sit + rhs.len_, tmp_obj.val_);
-            sit += rhs.len_;
-            tmp_obj.ShrinkLen();
-            tmp_obj.RMNTMulEqGiven(v, n, rhs.len_);
-            BiasedAddEq(tmp_obj, i * rhs.len_, false);
-        }
-        tmp_obj = BigInt<uint128_t>(0);
-        tmp_obj.SetLen(sterm - sit + 1, false);
-        *(tmp_obj.end_ - 1) = 0;
-        std::copy(sit, sterm, tmp_obj.val_);
-        tmp_obj.ShrinkLen();
-        tmp_obj.RMNTMulEqGiven(v, n, rhs.len_);
-        BiasedAddEq(tmp_obj, i * rhs.len_, false);
-        delete[] v;
-    } else {
-        auto it = reinterpret_cast<uint16_t*>(val_);
-        auto term = reinterpret_cast<uint16_t*>(end_);
-        auto this_len = len_;
-        while (n <= this_len) n <<= 1;
-        n <<= 4;
-        k = (rhs.len_ + this_len - 1) / this_len;
-        v = new int64_t[n];
-        auto vit = v;
-        for (; it < term; vit += 8, it += 8) {
-            for (int j = 0; j < 8; j += 2) {
-                *(vit + j) = *(it + j);
-                *(vit + j + 1) = *(it + j + 1);
-            }
-        }
-        std::fill(vit, v + n, 0);
-        RMNT(v, n, false);
-        *this = BigInt<uint128_t>(0);
-        auto cit = rhs.val_;
-        auto cterm = rhs.end_;
-        for (i = 0; i < k - 1; ++i) {
-            tmp_obj.SetLen(this_len + 1, false);
-            *(tmp_obj.end_ - 1) = 0;
-            std::copy(cit, cit + this_len, tmp_obj.val_);
-            cit += this_len;
-            tmp_obj.ShrinkLen();
-            tmp_obj.RMNTMulEqGiven(v, n, this_len);
-            BiasedAddEq(tmp_obj, i * this_len, false);
-        }
-        tmp_obj = BigInt<uint128_t>(0);
-        tmp_obj.SetLen(cterm - cit + 1, false);
-        *(tmp_obj.end_ - 1) = 0;
-        std::copy(cit, cterm, tmp_obj.val_);
-        tmp_obj.ShrinkLen();
-        tmp_obj.RMNTMulEqGiven(v, n, this_len);
-        BiasedAddEq(tmp_obj, i * this_len, false);
-        delete[] v;
-    }
+    while (n <= slen) n <<= 1;
+    n <<= 4;
+    auto src = NewScratch<int64_t>(n);
+    LoadDigits16(src, n, this_long ? rhs : *this);
+    RMNT(src, n, false);
+    BigInt<uint128_t> save_this;
+    if (this_long) save_this = std::move(*this);
+    const BigInt& x = this_long ? save_this : rhs;
+    auto mx = Magnitude(x);
+    auto a = reinterpret_cast<const uint64_t*>(mx);
+    uint64_t an = x.len_ << 1, cn = slen << 1, pn = cn << 1;
+    SetLenUninit(x.len_ + slen + 1);
+    auto d = reinterpret_cast<uint64_t*>(val_);
+    uint64_t dn = len_ << 1;
+    std::fill(d, d + dn, 0);
+    auto v = NewScratch<int64_t>(n);
+    auto p = NewScratch<uint64_t>(pn);
+    for (uint64_t i = 0; i < an; i += cn) {
+        uint64_t m = std::min(pn, dn - i);
+        MulGiven64(p, m, a + i, std::min(cn, an - i), src, n, v);
+        uint64_t c = AddN64(d + i, p, m);
+        for (uint64_t k = i + m; c && k < dn; ++k) c = !++d[k];
+    }
+    DeleteScratch(p, pn);
+    DeleteScratch(v, n);
+    if (x.Sign()) DeleteScratch(mx, x.len_);
+    DeleteScratch(src, n);
     if (sign) ToOpposite();
     ShrinkLen();
     return *this;
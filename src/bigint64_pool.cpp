@@ -0,0 +1,130 @@
+#include <algorithm>
+
+#include "bigint64.hpp"
+namespace calc {
+WorkerPool::WorkerPool(unsigned threads) {
+    for (unsigned i = 0; i < threads; ++i)
+        threads_.emplace_back(&WorkerPool::Worker, this);
+}
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    for (auto& t : threads_) t.join();
+}
+WorkerPool& WorkerPool::Shared() {
+    static WorkerPool pool(std::max(1u, std::thread::hardware_concurrency()) -
+                           1);
+    auto p = shared_.load(std::memory_order_acquire);
+    return p ? *p : pool;
+}
+void WorkerPool::SetShared(WorkerPool* pool) {
+    shared_.store(pool, std::memory_order_release);
+}
+WorkerPool::Task::~Task() = default;
+unsigned WorkerPool::Threads() const { return unsigned(threads_.size()) + 1; }
+void WorkerPool::Run(Task* task) {
+    {
+        // the task may be another caller's, its values must not come from
+        // the pool of this thread
+        LimbResourceScope scope(DefaultLimbResource());
+        try {
+            task->fn();
+        } catch (...) {
+            task->error = std::current_exception();
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        task->done.store(true, std::memory_order_release);
+    }
+    done_cv_.notify_all();
+}
+bool WorkerPool::RunOne() {
+    Task* task;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (queue_.empty()) return false;
+        // newest first, most likely the task we are waiting for
+        task = queue_.back();
+        queue_.pop_back();
+    }
+    Run(task);
+    return true;
+}
+void WorkerPool::Worker() {
+    while (true) {
+        Task* task;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+            if (queue_.empty()) return;
+            // oldest first, the biggest piece of work
+            task = queue_.front();
+            queue_.pop_front();
+        }
+        Run(task);
+    }
+}
+void WorkerPool::Wait(const Task& task) {
+    // help instead of blocking, so nested forks can not deadlock; sleep
+    // only when the task is running elsewhere and nothing is queued
+    while (!task.done.load(std::memory_order_acquire)) {
+        if (RunOne()) continue;
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_cv_.wait(lock, [&] {
+            return task.done.load(std::memory_order_relaxed) ||
+                   !queue_.empty();
+        });
+    }
+}
+void WorkerPool::Fork(const std::function<void()>& a,
+                      const std::function<void()>& b) {
+    if (threads_.empty()) {
+        a();
+        // as if run by a worker
+        LimbResourceScope scope(DefaultLimbResource());
+        b();
+        return;
+    }
+    Task task;
+    task.fn = b;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_.push_back(&task);
+    }
+    cv_.notify_one();
+    try {
+        a();
+    } catch (...) {
+        // task must not be run once this frame is gone
+        bool queued;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = std::find(queue_.begin(), queue_.end(), &task);
+            queued = it != queue_.end();
+            if (queued) queue_.erase(it);
+        }
+        if (!queued) Wait(task);
+        throw;
+    }
+    Wait(task);
+    if (task.error) std::rethrow_exception(task.error);
+}
+void WorkerPool::ParallelFor(
+    uint64_t n, uint64_t grain,
+    const std::function<void(uint64_t, uint64_t)>& fn) {
+    if (n <= grain || threads_.empty()) {
+        fn(0, n);
+        return;
+    }
+    uint64_t h = n >> 1;
+    Fork([&] { ParallelFor(h, grain, fn); },
+         [&] {
+             ParallelFor(n - h, grain,
+                         [&](uint64_t i, uint64_t j) { fn(h + i, h + j); });
+         });
+}
+}  // namespace calc
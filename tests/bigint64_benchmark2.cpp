@@ -104,5 +104,44 @@ int main() {
                 duration.count() / 1e3 / tot_len);
     std::cout << (res & and_val) << "(prevent optimizing out the whole loop)"
               << std::endl;
+    // the same products divided exactly and by the general division, at
+    // the whole range, within the schoolbook band, and for short quotients
+    auto exact_test = [&](const char* name, uint16_t qmin, uint16_t qmax,
+                          uint16_t vmin, uint16_t vmax, int count) {
+        std::uniform_int_distribution<uint16_t> qran(qmin, qmax),
+            vran(vmin, vmax);
+        std::vector<BI> prods(count), divs(count);
+        tot_len = 0;
+        for (int i = 0; i < count; ++i) {
+            a.GenRandom(qran(ran_eng));
+            divs[i].GenRandom(vran(ran_eng));
+            prods[i] = a * divs[i];
+            tot_len += prods[i].Length();
+        }
+        start_time = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < count; ++i)
+            res ^= BI::DivExact(prods[i], divs[i]);
+        end_time = std::chrono::high_resolution_clock::now();
+        auto exact_dur = end_time - start_time;
+        start_time = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < count; ++i) res ^= prods[i] / divs[i];
+        end_time = std::chrono::high_resolution_clock::now();
+        duration = end_time - start_time;
+        std::cout << std::endl;
+        std::printf("Tested exact division, %s", name);
+        std::printf(" on %d samples. Total length is %llu.\n", count,
+                    static_cast<unsigned long long>(tot_len));
+        std::printf("Total time is %.3lfms, %.3lfms by auto-distribute"
+                    " division.\n",
+                    exact_dur.count() / 1e6, duration.count() / 1e6);
+        std::printf("Speedup is %.2lfx.\n",
+                    double(duration.count()) / double(exact_dur.count()));
+        std::cout << (res & and_val)
+                  << "(prevent optimizing out the whole loop)" << std::endl;
+    };
+    exact_test("whole range", ran.min(), ran.max(), ran.min(), ran.max(),
+               test_count);
+    exact_test("schoolbook band", 16, 48, 16, 48, test_count << 10);
+    exact_test("short quotients", 1, 32, 256, 2048, test_count << 4);
     return 0;
 }
@@ -2,6 +2,8 @@
 
 #include <chrono>
 #include <iostream>
+#include <sstream>
+#include <stdexcept>
 using calc::uint128_t;
 using BI = calc::BigInt<uint128_t>;
 void do_test(const BI& a, const BI& b) {
@@ -51,8 +53,177 @@ void do_test(const BI& a, const BI& b) {
     std::cout << "print("
               << "-" << b << " == " << (-b) << ")" << std::endl;
 }
+void pool_test() {
+    // exceptions of either half of a fork reach the caller, that of a
+    // first, and b never runs after Fork returns
+    calc::WorkerPool pool(2);
+    std::atomic<int> runs{0};
+    int caught = 0;
+    for (int i = 0; i < 200; ++i) {
+        try {
+            pool.Fork([] { throw std::runtime_error("a"); }, [&] { ++runs; });
+        } catch (const std::runtime_error& e) {
+            caught += e.what()[0] == 'a';
+        }
+        try {
+            pool.Fork([] {}, [] { throw std::runtime_error("b"); });
+        } catch (const std::runtime_error& e) {
+            caught += e.what()[0] == 'b';
+        }
+        try {
+            pool.Fork([] { throw std::runtime_error("a"); },
+                      [] { throw std::runtime_error("b"); });
+        } catch (const std::runtime_error& e) {
+            caught += e.what()[0] == 'a';
+        }
+    }
+    int before = runs;
+    // and the pool still works
+    calc::WorkerPool::SetShared(&pool);
+    BI x;
+    x.GenRandom(4500);
+    bool ok = BI(x.ToString(10)) == x;
+    calc::WorkerPool::SetShared(nullptr);
+    std::cout << "print(" << (ok && caught == 600 && runs == before && runs <= 200
+                                  ? "True"
+                                  : "False")
+              << ")" << std::endl;
+}
+void load_text_test() {
+    // one sign only, before the base prefix
+    const char* texts[] = {"-0x1f\n", "--5\n", "-0x-5\n", "+-5\n", "-\n"};
+    bool ok[5];
+    BI x[5];
+    for (int i = 0; i < 5; ++i) {
+        std::FILE* f = std::fopen("bigint64_test.tmp", "w");
+        std::fputs(texts[i], f);
+        std::fclose(f);
+        x[i] = calc::LoadText("bigint64_test.tmp", 0, &ok[i]);
+    }
+    std::remove("bigint64_test.tmp");
+    std::cout << "print("
+              << (ok[0] && x[0] == BI(-31) && !ok[1] && !ok[2] && !ok[3] &&
+                          !ok[4]
+                      ? "True"
+                      : "False")
+              << ")" << std::endl;
+}
+void digit_count_test() {
+    // the cached powers outlive a pool of the caller
+    BI x = calc::Power(BI(10), 700);
+    uint64_t n[2];
+    {
+        calc::LimbPool pool;
+        calc::LimbResourceScope scope(&pool);
+        n[0] = x.DigitCount();
+    }
+    n[1] = (x * 1000).DigitCount();
+    std::cout << "print(" << (n[0] == 701 && n[1] == 704 ? "True" : "False")
+              << ")" << std::endl;
+}
+void lazy_test() {
+    BI a, b, c, d, e, x, y;
+    a.GenRandom(12).ToOpposite();
+    b.GenRandom(9);
+    c.GenRandom(40);
+    d.GenRandom(30).ToOpposite();
+    e.GenRandom(50);
+    x = calc::Lazy(a) * b + calc::Lazy(c) * d - e;
+    y = e;
+    y = (calc::Lazy(y) << 70) - calc::Lazy(a) * y + (calc::Lazy(c) ^ d);
+    std::cout << "a, b, c, d, e = " << a << ", " << b << ", " << c << ", " << d
+              << ", " << e << "\nprint(" << x << " == a * b + c * d - e and "
+              << y << " == (e << 70) - a * e + (c ^ d))" << std::endl;
+}
+void out_param_test() {
+    BI a, b, q, r, x, y;
+    a.GenRandom(20).ToOpposite();
+    b.GenRandom(7);
+    calc::Mul(x, a, b);
+    calc::Sub(x, x, b);
+    calc::Add(x, a, x);
+    y = b;
+    calc::DivMod(q, &r, x, y);
+    calc::Mul(y, y, y);
+    // quotients truncate toward zero
+    std::cout << "a, b = " << a << ", " << b << "\nn = a * b - b + a"
+              << "\nt = -(-n // b) if n < 0 else n // b\nprint(" << x
+              << " == n and " << q << " == t and " << r << " == n - t * b"
+              << " and " << y << " == b * b)" << std::endl;
+}
+void sign_test() {
+    // every kernel with every combination of signs
+    BI a, b, c, q, r, x, y;
+    for (int i = 0; i < 4; ++i) {
+        a.GenRandom(120);
+        b.GenRandom(100);
+        c.GenRandom(9);
+        if (i & 1) a.ToOpposite();
+        if (i & 2) b.ToOpposite(), c.ToOpposite();
+        BI p[] = {a * c,
+                  BI::RMNTMul(a, b),
+                  BI::MNTMul(a, b),
+                  BI::MulKaratsuba(a, b),
+                  BI::Square(a),
+                  BI::RMNTMulUB(a, c),
+                  BI::RMNTMulUB(c, a)};
+        x = a * a * a;
+        q = x / b;
+        r = x % b;
+        y = a / c;
+        std::cout << "a, b, c = " << a << ", " << b << ", " << c
+                  << "\nn = a * a * a\nprint(" << p[0] << " == a * c and "
+                  << p[1] << " == a * b and " << p[2] << " == a * b and "
+                  << p[3] << " == a * b and " << p[4] << " == a * a and "
+                  << p[5] << " == a * c and " << p[6] << " == a * c and "
+                  << q << " == (abs(n) // abs(b)) * (1 if (n < 0) == (b < 0)"
+                  << " else -1) and " << r << " == n - " << q << " * b and "
+                  << y << " == (abs(a) // abs(c)) * (1 if (a < 0) == (c < 0)"
+                  << " else -1))" << std::endl;
+    }
+}
+void high_test() {
+    BI a;
+    a.GenRandom(9).ToOpposite();
+    calc::BigIntView h[] = {calc::BigIntView::High(a, 4),
+                            calc::BigIntView::High(a, 8),
+                            calc::BigIntView::High(a, 12)};
+    std::cout << "a = " << a << "\nprint(" << h[0].Value()
+              << " == a >> 512 and " << h[1].Value() << " == a >> 1024 and "
+              << h[2].Value() << " == a >> 1536)" << std::endl;
+    // products of the division taken by FFT on the digits in place
+    BI b, q, r;
+    a.GenRandom(6000).ToOpposite();
+    b.GenRandom(2100);
+    q = a;
+    q.DivEq(b, &r);
+    bool ok = q * b + r == a && r.Sign() && -r < b;
+    std::cout << "print(" << (ok ? "True" : "False") << ")" << std::endl;
+}
+void huge_page_test() {
+    // large blocks freed after the switch changed, all on cache lines
+    auto aligned = [](const BI& v) {
+        return !(reinterpret_cast<uintptr_t>(v.Data()) & 63);
+    };
+    bool prev = calc::SetHugePages(true);
+    auto mapped = std::make_unique<BI>();
+    mapped->GenRandom(140000).ToOpposite();
+    BI small;
+    small.GenRandom(20);
+    calc::SetHugePages(false);
+    auto heap = std::make_unique<BI>(*mapped);
+    bool ok = aligned(*mapped) && aligned(*heap) && aligned(small) &&
+              *heap == *mapped && heap->Length() >= 140000;
+    BI sum = *mapped + *heap;
+    mapped.reset();
+    calc::SetHugePages(true);
+    ok = ok && sum == *heap * 2;
+    heap.reset();
+    calc::SetHugePages(prev);
+    std::cout << "print(" << (ok ? "True" : "False") << ")" << std::endl;
+}
 int main() {
-    BI a(0), b;
+    BI a(0), b, x, y;
     constexpr int len1 = 3, len2 = 7, len3 = 2;
     do_test(a.GenRandom(len1), b.GenRandom(len2));
     std::cout << "print()" << std::endl;
@@ -69,5 +240,102 @@ int main() {
     do_test(a.GenRandom(len3), b.GenRandom(len3).ToOpposite());
     std::cout << "print()" << std::endl;
     do_test(a.GenRandom(len3).ToOpposite(), b.GenRandom(len3).ToOpposite());
+    std::cout << "print()" << std::endl;
+    // large enough for the parallel radix conversion
+    calc::WorkerPool pool(3);
+    calc::WorkerPool::SetShared(&pool);
+    auto str = a.GenRandom(4500).ToOpposite().ToString(10);
+    std::cout << "print(" << a << " == " << str << ")" << std::endl;
+    std::cout << "print(" << (BI(str) == a ? "True" : "False") << ")"
+              << std::endl;
+    str = a.ToString(8, 0);
+    std::cout << "print(" << a << " == -0o" << str.substr(1) << ")"
+              << std::endl;
+    std::stringstream ss;
+    ss << std::dec << a << " " << std::hex << a << " " << std::oct << a;
+    ss >> std::dec >> b >> std::hex >> x >> std::oct >> y;
+    std::cout << "print(" << (b == a && x == a && y == a ? "True" : "False")
+              << ")" << std::endl;
+    calc::WorkerPool::SetShared(nullptr);
+    pool_test();
+    char chars[128];
+    auto res = a.GenRandom(2).ToOpposite().ToChars(chars, chars + 128, 36);
+    std::cout << "print(" << a << " == int('" << std::string(chars, res.ptr)
+              << "', 36))" << std::endl;
+    std::cout << "print(" << (x.FromChars(chars, res.ptr, 36) ==
+                                          size_t(res.ptr - chars) &&
+                                      x == a
+                                  ? "True"
+                                  : "False")
+              << ")" << std::endl;
+    a.GenRandom(300).ToOpposite();
+    bool ok = calc::SaveText("bigint64_test.tmp", a, 10);
+    x = calc::LoadText("bigint64_test.tmp", 0, &ok);
+    std::remove("bigint64_test.tmp");
+    std::cout << "print(" << (ok && x == a ? "True" : "False") << ")"
+              << std::endl;
+    load_text_test();
+    ok = calc::SaveBinary("bigint64_test.tmp", a);
+    y = calc::LoadBinary("bigint64_test.tmp", &ok);
+    {
+        calc::MappedBigInt m("bigint64_test.tmp");
+        ok = ok && m && m.Value() == a;
+    }
+    std::remove("bigint64_test.tmp");
+    std::cout << "print(" << (ok && y == a ? "True" : "False") << ")"
+              << std::endl;
+    std::vector<BI> batch(50);
+    for (auto&& v : batch) v.GenRandom(1 + rand() % 20).ToOpposite();
+    batch[7] = BI(0);
+    auto buf = calc::SerializeBatch(batch.data(), batch.size());
+    auto views = calc::DeserializeBatch(buf.data(), buf.size(), &ok);
+    for (size_t i = 0; ok && i < batch.size(); ++i)
+        ok = views[i].Value() == batch[i];
+    std::cout << "print(" << (ok && views.size() == 50 ? "True" : "False")
+              << ")" << std::endl;
+    a.GenRandom(300).ToOpposite();
+    std::cout << "print(str(abs(" << a << "))[:40] == '" << a.LeadingDigits(40)
+              << "' and str(abs(" << a << "))[-40:] == '"
+              << a.TrailingDigits(40) << "')" << std::endl;
+    a = calc::Power(BI(10), 500);
+    std::cout << "print(" << a.DigitCount() << " == 501 and len(str(abs("
+              << --a << "))) == " << a.DigitCount() << ")" << std::endl;
+    digit_count_test();
+    std::vector<BI> column(2000);
+    for (auto&& v : column) v.GenRandom(1 + rand() % 3) >>= rand() % 300;
+    auto text = calc::FormatBatch(column.data(), column.size(), ',');
+    ok = calc::ParseBatch(text.data(), text.data() + text.size(), &batch);
+    for (size_t i = 0; ok && i < column.size(); ++i)
+        ok = batch[i] == column[i];
+    std::cout << "print(" << (ok && batch.size() == 2000 ? "True" : "False")
+              << ")" << std::endl;
+    {
+        calc::LimbResourceScope scope(&calc::LimbPool::Local());
+        x = calc::Power(BI(3), 20000);
+        y = calc::Power(BI(3), 10000);
+        ok = x == y * y;
+    }
+    std::cout << "print(" << (ok ? "True" : "False") << ")" << std::endl;
+    x.GenRandom(700).ToOpposite();
+    y.GenRandom(300);
+    std::cout << "print(" << BI::MulKaratsuba(x, y) << " == " << x << " * " << y
+              << ")" << std::endl;
+    {
+        calc::LimbResourceScope scope(&calc::LimbPool::Local());
+        calc::SharedBigInt s = calc::Power(BI(7), 3000);
+        std::vector<calc::SharedBigInt> copies(100, s);
+        ok = copies[99].Value().Data() == s.Value().Data() &&
+             s.UseCount() == 101 && copies[0] + BI(1) - s == BI(1);
+        copies.clear();
+        auto data = s.Value().Data();
+        x = s.Take();
+        ok = ok && x.Data() == data && x == calc::Power(BI(7), 3000) && !s.Value();
+    }
+    std::cout << "print(" << (ok ? "True" : "False") << ")" << std::endl;
+    lazy_test();
+    out_param_test();
+    sign_test();
+    high_test();
+    huge_page_test();
     return 0;
 }
@@ -49,11 +49,16 @@ void do_test(const BI& a, const BI& b) {
     }
     std::cout << "print(" << a << " == " << b << " * " << a.DivR(a, b, &c);
     std::cout << " + " << c << ")" << std::endl;
+    std::cout << "print(" << a << " == " << a.DivExact(a * b, b) << ")"
+              << std::endl;
+    t = std::rand();
+    std::cout << "print(" << b << " == " << BI(b * t).DivExactEq(t) << ")"
+              << std::endl;
 }
 int main() {
     std::srand(unsigned(time(nullptr)));
     BI a(0), b;
-    constexpr int len1 = 7, len2 = 5, len3 = 1;
+    constexpr int len1 = 7, len2 = 5, len3 = 1, len4 = 200, len5 = 90;
     do_test(a.GenRandom(len1), b.GenRandom(len2));
     std::cout << "print()" << std::endl;
     do_test(a.GenRandom(len1).ToOpposite(), b.GenRandom(len2));
@@ -69,5 +74,9 @@ int main() {
     do_test(a.GenRandom(len3), b.GenRandom(len3).ToOpposite());
     std::cout << "print()" << std::endl;
     do_test(a.GenRandom(len3).ToOpposite(), b.GenRandom(len3).ToOpposite());
+    std::cout << "print()" << std::endl;
+    do_test(a.GenRandom(len4), b.GenRandom(len5));
+    std::cout << "print()" << std::endl;
+    do_test(a.GenRandom(len4).ToOpposite(), b.GenRandom(len5));
     return 0;
 }
@@ -23,5 +23,27 @@ int main() {
         std::cout << "print(" << c << " == " << a << " * " << x << " + " << b
                   << " * " << y << ")" << std::endl;
     }
+    uint64_t root_len[] = {1, 2, 7, 60, 500};
+    for (auto len : root_len) {
+        c = calc::SqrtRem(a.GenRandom(len), &x);
+        std::cout << "print(" << c << " == math.isqrt(" << a << ") and " << x
+                  << " == " << a << " - " << c << "**2)" << std::endl;
+        for (uint64_t k = 3; k < 40; k += 12) {
+            c = calc::Root(a, k);
+            std::cout << "print(" << c << "**" << k << " <= " << a << " < ("
+                      << c << " + 1)**" << k << ")" << std::endl;
+        }
+    }
+    BI special[] = {(BI(1) << 521) - BI(1), (BI(1) << 256) + BI(1),
+                    (BI(1) << 255) - BI(19)};
+    for (auto& n : special) {
+        b.GenRandom(3);
+        std::cout << "print(" << calc::PowMod(b, a.GenRandom(2), n)
+                  << " == pow(" << b << ", " << a << ", " << n << "))"
+                  << std::endl;
+        c = calc::MulMod(a.GenRandom(7), -b, n);
+        std::cout << "print(" << c << " == " << a << " * " << -b << " % " << n
+                  << " - (" << n << " if " << c << " else 0))" << std::endl;
+    }
     return 0;
 }